@@ -0,0 +1,117 @@
+// XMPlay SIDevo headless host - just enough of the Win32 API for the plugin and the XMPlay SDK headers
+// only put this folder on the include path for non-Windows builds
+#pragma once
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#define WINAPI
+#define CALLBACK
+#define __stdcall
+#define __declspec(x)
+#define __int64 long long
+
+#define FALSE 0
+#define TRUE 1
+#define MAX_PATH 260
+#define _MAX_PATH PATH_MAX
+
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef int BOOL;
+typedef unsigned int UINT;
+typedef uintptr_t WPARAM;
+typedef intptr_t LPARAM;
+typedef intptr_t LRESULT;
+typedef void* LPVOID;
+typedef char CHAR;
+typedef char TCHAR;
+typedef wchar_t WCHAR;
+typedef char* LPSTR;
+typedef const char* LPCSTR;
+typedef wchar_t* LPWSTR;
+typedef const wchar_t* LPCWSTR;
+
+typedef void* HANDLE;
+typedef HANDLE HWND;
+typedef HANDLE HINSTANCE;
+typedef HANDLE HMODULE;
+typedef HANDLE HDC;
+typedef HANDLE HBITMAP;
+typedef HANDLE HICON;
+typedef HANDLE HMENU;
+typedef HANDLE HFONT;
+
+typedef struct
+{
+	long left;
+	long top;
+	long right;
+	long bottom;
+} RECT;
+typedef struct
+{
+	long cx;
+	long cy;
+} SIZE;
+typedef struct
+{
+	long x;
+	long y;
+} POINT;
+
+#define LOWORD(l) ((WORD)((DWORD)(l) & 0xffff))
+#define HIWORD(l) ((WORD)(((DWORD)(l) >> 16) & 0xffff))
+#define MAKELONG(a, b) ((DWORD)(((WORD)(a)) | ((DWORD)((WORD)(b))) << 16))
+
+#define MB_ICONEXCLAMATION 0x30
+#define DLL_PROCESS_ATTACH 1
+
+#define _stricmp strcasecmp
+#define _strnicmp strncasecmp
+
+// milliseconds since an arbitrary point, wraps like the real one
+static inline DWORD GetTickCount()
+{
+	struct timespec tickTime;
+	clock_gettime(CLOCK_MONOTONIC, &tickTime);
+	return (DWORD)(tickTime.tv_sec * 1000 + tickTime.tv_nsec / 1000000);
+}
+
+// the plugin is linked into the host, so its module is the host executable
+static inline DWORD GetModuleFileNameA(HMODULE module, char* fileName, DWORD size)
+{
+	ssize_t nameLength = readlink("/proc/self/exe", fileName, size - 1);
+	if (nameLength < 0) {
+		nameLength = 0;
+	}
+	fileName[nameLength] = 0;
+	return (DWORD)nameLength;
+}
+#define GetModuleFileName GetModuleFileNameA
+
+// resolves through realpath, which unlike the CRT one wants the path to exist, so anything it can't find comes back as given
+static inline char* _fullpath(char* absPath, const char* relPath, size_t maxLength)
+{
+	if (realpath(relPath, absPath) == NULL) {
+		if (strlen(relPath) >= maxLength) {
+			return NULL;
+		}
+		strcpy(absPath, relPath);
+	}
+	return absPath;
+}
+
+// nobody to click OK, print it instead
+static inline int MessageBoxA(HWND win, const char* text, const char* caption, UINT type)
+{
+	fprintf(stderr, "%s: %s\n", caption ? caption : "Error", text);
+	return 1;
+}
@@ -0,0 +1,4 @@
+// XMPlay SIDevo headless host - the XMPlay SDK headers pull in the Win32 types from here
+#pragma once
+
+#include "windows.h"
@@ -0,0 +1,244 @@
+// XMPlay SIDevo headless host - render throughput across the emulation settings, results as JSON
+#include "xmphost.h"
+#include "synthtune.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+typedef struct
+{
+	std::string name;
+	std::string filename;
+	int sids;
+} BENCHtune;
+
+typedef struct
+{
+	const char* engine;
+	const char* model;
+	const char* clock;
+	bool filter;
+	const char* method;
+	DWORD rate;
+	DWORD chans;
+} BENCHconfig;
+
+static void usage() {
+	fprintf(stderr,
+		"usage: sidevo-bench [options] [extra.sid ...]\n"
+		"  -t SECONDS    audio rendered per configuration (default 10)\n"
+		"  -b SAMPLES    samples asked for per Process call (default 4096)\n"
+		"  -q            quick run, 44100 Hz stereo only\n"
+		"  -k KEY=VALUE  extra registry setting applied to every run\n"
+		"  -o FILE       write the JSON here instead of stdout\n");
+}
+
+// SID count from a PSID/RSID header, v3 and up can name a second and third chip
+static int tuneSids(const std::vector<uint8_t>& data) {
+	if (data.size() < 0x7c || data[0x05] < 3) {
+		return 1;
+	}
+	return 1 + (data[0x7a] ? 1 : 0) + (data[0x7b] ? 1 : 0);
+}
+
+static double percentile(std::vector<double> values, double fraction) {
+	if (values.empty()) {
+		return 0;
+	}
+	std::sort(values.begin(), values.end());
+	size_t index = (size_t)std::ceil(fraction * values.size());
+	return values[std::min(std::max<size_t>(index, 1), values.size()) - 1];
+}
+
+static bool benchRun(FILE* json, bool first, XMPIN* plugin, const BENCHtune& tune, const BENCHconfig& config, double seconds, DWORD block) {
+	hostSetting("c_sidengine", config.engine);
+	hostSetting("c_sidmodel", config.model);
+	hostSetting("c_clockspeed", config.clock);
+	hostSetting("c_enablefilter", config.filter ? 1 : 0);
+	hostSetting("c_samplemethod", config.method);
+	hostReconfigure();
+
+	HOSTsong song;
+	if (!hostOpenSong(&song, plugin, tune.filename.c_str(), config.rate, config.chans, 1)) {
+		fprintf(stderr, "%s: not a tune the plugin can play\n", tune.filename.c_str());
+		return false;
+	}
+
+	// the first block pays for the engine start-up, leave it out
+	std::vector<float> buffer(block);
+	plugin->Process(buffer.data(), block);
+
+	const double samplelimit = seconds * song.format.rate * song.format.chan;
+	const double blockDeadline = (double)block / (song.format.rate * song.format.chan);
+	std::vector<double> blockTimes;
+	int deadlineMisses = 0;
+	double samples = 0;
+	double wallSeconds = 0;
+	while (samples < samplelimit) {
+		std::chrono::steady_clock::time_point blockStart = std::chrono::steady_clock::now();
+		DWORD done = plugin->Process(buffer.data(), block);
+		double blockSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - blockStart).count();
+		if (!done) {
+			break;
+		}
+		wallSeconds += blockSeconds;
+		blockTimes.push_back(blockSeconds);
+		if (blockSeconds > blockDeadline) {
+			deadlineMisses++;
+		}
+		samples += done;
+	}
+	hostCloseSong(&song);
+
+	const double frames = samples / song.format.chan;
+	const double audioSeconds = frames / song.format.rate;
+	fprintf(json, "%s\n    {\"tune\": \"%s\", \"sids\": %d, \"engine\": \"%s\", \"model\": \"%s\", \"clock\": \"%s\", \"filter\": %s, \"method\": \"%s\", \"rate\": %u, \"chans\": %u, "
+		"\"audio_seconds\": %.3f, \"wall_seconds\": %.6f, \"realtime\": %.2f, \"ns_per_frame\": %.2f, \"p99_block_us\": %.1f, \"max_block_us\": %.1f, "
+		"\"p99_deadline\": %.4f, \"deadline_misses\": %d}",
+		first ? "" : ",", tune.name.c_str(), tune.sids, config.engine, config.model, config.clock, config.filter ? "true" : "false", config.method, song.format.rate, song.format.chan,
+		audioSeconds, wallSeconds, wallSeconds > 0 ? audioSeconds / wallSeconds : 0, frames > 0 ? wallSeconds * 1e9 / frames : 0,
+		percentile(blockTimes, 0.99) * 1e6, percentile(blockTimes, 1.0) * 1e6, percentile(blockTimes, 0.99) / blockDeadline, deadlineMisses);
+	fflush(json);
+	fprintf(stderr, "%-12s %d SID %-7s %s %-4s filter %-3s %-8s %5u Hz %u ch  %7.1fx realtime\n", tune.name.c_str(), tune.sids, config.engine, config.model, config.clock,
+		config.filter ? "on" : "off", config.method, song.format.rate, song.format.chan, wallSeconds > 0 ? audioSeconds / wallSeconds : 0);
+	return true;
+}
+
+int main(int argc, char** argv) {
+	double seconds = 10;
+	DWORD block = 4096;
+	bool quick = false;
+	const char* outname = NULL;
+	std::vector<BENCHtune> tunes;
+
+	// the same settings for every run, nothing but the matrix may change the work done
+	hostSetting("c_locksidmodel", 1);
+	hostSetting("c_lockclockspeed", 1);
+	hostSetting("c_powerdelay", 0);
+	hostSetting("c_powerdelayrandom", 0);
+	hostSetting("c_defaultlength", 0);
+	hostSetting("c_forcelength", 1);
+	hostSetting("c_fadein", 0);
+	hostSetting("c_fadeout", 0);
+	hostSetting("c_addfadeout", 0);
+	hostSetting("c_skipshort", 0);
+	hostSetting("c_defaultskip", 0);
+	hostSetting("c_detectplayer", 0);
+	hostSetting("c_detectlength", 0);
+	hostSetting("c_trimsilence", 0);
+	hostSetting("c_loopcache", 0);
+	hostSetting("c_forcemono", 0);
+	hostSetting("c_governor", 0);
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+			seconds = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+			block = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-q")) {
+			quick = true;
+		} else if (!strcmp(argv[i], "-k") && i + 1 < argc) {
+			if (!hostSetting(argv[++i])) {
+				usage();
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+			outname = argv[++i];
+		} else if (argv[i][0] != '-') {
+			HOSTfile* file = hostOpenFile(argv[i]);
+			if (!file) {
+				fprintf(stderr, "%s: can't read\n", argv[i]);
+				return 1;
+			}
+			BENCHtune tune;
+			tune.filename = argv[i];
+			tune.name = tune.filename.substr(tune.filename.find_last_of("\\/") + 1);
+			tune.sids = tuneSids(file->data);
+			hostCloseFile(file);
+			tunes.push_back(tune);
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (!block || seconds <= 0) {
+		usage();
+		return 1;
+	}
+
+	// the synthetic corpus comes first so results line up between machines
+	for (int sids = 3; sids >= 1; sids--) {
+		BENCHtune tune;
+		tune.name = std::string("synth-") + std::to_string(sids) + "sid";
+		tune.filename = tune.name + ".sid";
+		tune.sids = sids;
+		hostAddFile(tune.filename.c_str(), synthTune(sids));
+		tunes.insert(tunes.begin(), tune);
+	}
+	// and an interrupt driven RSID, where the C64 side rather than the SID takes the time
+	BENCHtune rsidTune;
+	rsidTune.name = "synth-rsid";
+	rsidTune.filename = rsidTune.name + ".sid";
+	rsidTune.sids = 1;
+	hostAddFile(rsidTune.filename.c_str(), synthRsid());
+	tunes.insert(tunes.begin() + 3, rsidTune);
+
+	XMPIN* plugin = hostLoad();
+	if (!plugin) {
+		fprintf(stderr, "plugin refused the interface\n");
+		return 1;
+	}
+	FILE* json = outname ? fopen(outname, "w") : stdout;
+	if (!json) {
+		fprintf(stderr, "%s: can't write\n", outname);
+		return 1;
+	}
+
+	const char* engines[] = { "ReSIDfp", "ReSID" };
+	const char* models[] = { "6581", "8580" };
+	const char* clocks[] = { "PAL", "NTSC" };
+	const bool filters[] = { true, false };
+	const char* methods[] = { "Normal", "Accurate" };
+	const DWORD rates[] = { 44100, 48000, 96000 };
+	const DWORD chans[] = { 1, 2 };
+
+	fprintf(json, "{\n  \"seconds\": %.3f,\n  \"block\": %u,\n  \"results\": [", seconds, block);
+	bool first = true;
+	bool failed = false;
+	for (const BENCHtune& tune : tunes) {
+		for (const char* engine : engines) {
+			for (const char* model : models) {
+				for (const char* clock : clocks) {
+					for (bool filter : filters) {
+						for (const char* method : methods) {
+							for (DWORD rate : rates) {
+								for (DWORD chan : chans) {
+									if (quick && (rate != 44100 || chan != 2)) {
+										continue;
+									}
+									BENCHconfig config = { engine, model, clock, filter, method, rate, chan };
+									if (benchRun(json, first, plugin, tune, config, seconds, block)) {
+										first = false;
+									} else {
+										failed = true;
+									}
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+	fprintf(json, "\n  ]\n}\n");
+	if (json != stdout) {
+		fclose(json);
+	}
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,320 @@
+// XMPlay SIDevo headless host - golden output regression check, records or verifies per-block hashes and reference PCM
+#include "xmphost.h"
+#include "synthtune.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// a fixed power-on delay, the random one would make every render different
+#define GOLDEN_POWERDELAY 2000
+
+typedef struct
+{
+	std::string name;
+	std::string filename;
+} GOLDENtune;
+
+typedef struct
+{
+	const char* name;
+	const char* model;
+	const char* clock;
+	const char* method;
+} GOLDENconfig;
+
+// what a golden file holds besides the reference PCM next to it
+typedef struct
+{
+	DWORD rate;
+	DWORD chans;
+	DWORD block;
+	DWORD samples;
+	std::vector<unsigned long long> hashes;
+} GOLDENrender;
+
+static const GOLDENconfig goldenConfigs[] = {
+	{ "6581-pal-normal", "6581", "PAL", "Normal" },
+	{ "8580-ntsc-accurate", "8580", "NTSC", "Accurate" },
+};
+
+static void usage() {
+	fprintf(stderr,
+		"usage: sidevo-golden --record DIR | --verify DIR [options] [extra.sid ...]\n"
+		"  -t SECONDS    audio recorded per sub-song (default 30)\n"
+		"  -b SAMPLES    samples asked for per Process call when recording (default 4096)\n"
+		"  -e LEVEL      largest sample difference still accepted, 0 is bit-exact (default 0)\n"
+		"  -n            record the hashes only, without the reference PCM (the set kept in host/golden)\n"
+		"  -k KEY=VALUE  extra registry setting, e.g. -k c_sidengine=ReSID to see how far it is from the recording\n");
+}
+
+// FNV-1a over the float bits, any change to a sample changes the hash
+static unsigned long long blockHash(const float* samples, DWORD count) {
+	unsigned long long hash = 14695981039346656037ULL;
+	const unsigned char* bytes = (const unsigned char*)samples;
+	for (size_t i = 0; i < count * sizeof(float); i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static bool readGolden(const std::string& filename, GOLDENrender* golden) {
+	FILE* goldfile = fopen(filename.c_str(), "r");
+	if (!goldfile) {
+		return false;
+	}
+	int version = 0;
+	bool valid = fscanf(goldfile, "sidevo-golden %d\n", &version) == 1 && version == 1
+		&& fscanf(goldfile, "rate %u\nchans %u\nblock %u\nsamples %u\n", &golden->rate, &golden->chans, &golden->block, &golden->samples) == 4
+		&& golden->block > 0;
+	unsigned long long hash;
+	while (valid && fscanf(goldfile, "%llx\n", &hash) == 1) {
+		golden->hashes.push_back(hash);
+	}
+	fclose(goldfile);
+	return valid && golden->hashes.size() == (golden->samples + golden->block - 1) / golden->block;
+}
+
+static bool writeGolden(const std::string& filename, const GOLDENrender& golden) {
+	FILE* goldfile = fopen(filename.c_str(), "w");
+	if (!goldfile) {
+		return false;
+	}
+	fprintf(goldfile, "sidevo-golden 1\nrate %u\nchans %u\nblock %u\nsamples %u\n", golden.rate, golden.chans, golden.block, golden.samples);
+	for (unsigned long long hash : golden.hashes) {
+		fprintf(goldfile, "%016llx\n", hash);
+	}
+	return fclose(goldfile) == 0;
+}
+
+// render one sub-song, hashing every block the way it was asked for
+static bool renderSong(XMPIN* plugin, const GOLDENtune& tune, int subsong, const GOLDENconfig& config, GOLDENrender* render, std::vector<float>* pcm) {
+	hostSetting("c_sidmodel", config.model);
+	hostSetting("c_clockspeed", config.clock);
+	hostSetting("c_samplemethod", config.method);
+	hostReconfigure();
+
+	HOSTsong song;
+	if (!hostOpenSong(&song, plugin, tune.filename.c_str(), render->rate, render->chans, subsong)) {
+		return false;
+	}
+	render->hashes.clear();
+	pcm->assign(render->samples, 0);
+	DWORD samples = 0;
+	while (samples < render->samples) {
+		DWORD count = std::min<DWORD>(render->block, render->samples - samples);
+		DWORD done = song.plugin->Process(pcm->data() + samples, count);
+		// the length is endless, a short block means the plugin stopped early and the block stays silent
+		render->hashes.push_back(blockHash(pcm->data() + samples, count));
+		samples += count;
+		if (done < count) {
+			while (samples < render->samples) {
+				count = std::min<DWORD>(render->block, render->samples - samples);
+				render->hashes.push_back(blockHash(pcm->data() + samples, count));
+				samples += count;
+			}
+		}
+	}
+	hostCloseSong(&song);
+	return true;
+}
+
+int main(int argc, char** argv) {
+	const char* recordDir = NULL;
+	const char* verifyDir = NULL;
+	double seconds = 30;
+	DWORD block = 4096;
+	double tolerance = 0;
+	bool keepPcm = true;
+	std::vector<GOLDENtune> tunes;
+
+	// the golden path is Open to Process with nothing random and nothing that ends the song
+	hostSetting("c_sidengine", "ReSIDfp");
+	hostSetting("c_locksidmodel", 1);
+	hostSetting("c_lockclockspeed", 1);
+	hostSetting("c_enablefilter", 1);
+	hostSetting("c_powerdelay", GOLDEN_POWERDELAY);
+	hostSetting("c_powerdelayrandom", 0);
+	hostSetting("c_defaultlength", 0);
+	hostSetting("c_forcelength", 1);
+	hostSetting("c_fadein", 0);
+	hostSetting("c_fadeout", 0);
+	hostSetting("c_addfadeout", 0);
+	hostSetting("c_skipshort", 0);
+	hostSetting("c_defaultskip", 0);
+	hostSetting("c_detectplayer", 0);
+	hostSetting("c_detectlength", 0);
+	hostSetting("c_trimsilence", 0);
+	hostSetting("c_loopcache", 0);
+	hostSetting("c_forcemono", 0);
+	hostSetting("c_governor", 0);
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--record") && i + 1 < argc) {
+			recordDir = argv[++i];
+		} else if (!strcmp(argv[i], "--verify") && i + 1 < argc) {
+			verifyDir = argv[++i];
+		} else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+			seconds = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+			block = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-e") && i + 1 < argc) {
+			tolerance = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "-n")) {
+			keepPcm = false;
+		} else if (!strcmp(argv[i], "-k") && i + 1 < argc) {
+			if (!hostSetting(argv[++i])) {
+				usage();
+				return 1;
+			}
+		} else if (argv[i][0] != '-') {
+			GOLDENtune tune;
+			tune.filename = argv[i];
+			tune.name = tune.filename.substr(tune.filename.find_last_of("\\/") + 1);
+			tune.name = tune.name.substr(0, tune.name.find_last_of('.'));
+			tunes.push_back(tune);
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (!recordDir == !verifyDir || !block || seconds <= 0 || tolerance < 0) {
+		usage();
+		return 1;
+	}
+
+	// the synthetic corpus, the 1 SID tune has a sub-song per filter mode
+	for (int sids = 3; sids >= 1; sids--) {
+		GOLDENtune tune;
+		tune.name = std::string("synth-") + std::to_string(sids) + "sid";
+		tune.filename = tune.name + ".sid";
+		hostAddFile(tune.filename.c_str(), synthTune(sids, sids == 1 ? 3 : 1));
+		tunes.insert(tunes.begin(), tune);
+	}
+	GOLDENtune rsidTune;
+	rsidTune.name = "synth-rsid";
+	rsidTune.filename = rsidTune.name + ".sid";
+	hostAddFile(rsidTune.filename.c_str(), synthRsid());
+	tunes.insert(tunes.begin() + 3, rsidTune);
+
+	XMPIN* plugin = hostLoad();
+	if (!plugin) {
+		fprintf(stderr, "plugin refused the interface\n");
+		return 1;
+	}
+
+	const std::string goldenDir = std::string(recordDir ? recordDir : verifyDir) + "/";
+	int checked = 0;
+	int failed = 0;
+	for (const GOLDENtune& tune : tunes) {
+		HOSTsong song;
+		if (!hostOpenSong(&song, plugin, tune.filename.c_str(), 44100, 2, 1)) {
+			fprintf(stderr, "%s: not a tune the plugin can play\n", tune.filename.c_str());
+			failed++;
+			continue;
+		}
+		const int subsongs = std::max<int>(song.subsongs, 1);
+		hostCloseSong(&song);
+
+		for (int subsong = 1; subsong <= subsongs; subsong++) {
+			for (const GOLDENconfig& config : goldenConfigs) {
+				const std::string basename = goldenDir + tune.name + "." + std::to_string(subsong) + "." + config.name;
+				GOLDENrender render;
+				std::vector<float> pcm;
+
+				if (recordDir) {
+					render.rate = 44100;
+					render.chans = 2;
+					render.block = block;
+					render.samples = (DWORD)(seconds * render.rate) * render.chans;
+					if (!renderSong(plugin, tune, subsong, config, &render, &pcm)) {
+						fprintf(stderr, "%s: not a tune the plugin can play\n", tune.filename.c_str());
+						failed++;
+						continue;
+					}
+					// without the reference PCM only the hashes can tell, so -e has nothing to compare against
+					bool written = true;
+					if (keepPcm) {
+						FILE* pcmfile = fopen((basename + ".pcm").c_str(), "wb");
+						written = pcmfile && fwrite(pcm.data(), sizeof(float), pcm.size(), pcmfile) == pcm.size();
+						if (pcmfile && fclose(pcmfile) != 0) {
+							written = false;
+						}
+					}
+					if (!written || !writeGolden(basename + ".golden", render)) {
+						fprintf(stderr, "%s: can't write\n", basename.c_str());
+						return 1;
+					}
+					printf("recorded  %s\n", basename.c_str());
+					checked++;
+					continue;
+				}
+
+				GOLDENrender golden;
+				if (!readGolden(basename + ".golden", &golden)) {
+					fprintf(stderr, "%s.golden: missing or damaged, record it first\n", basename.c_str());
+					failed++;
+					continue;
+				}
+				render.rate = golden.rate;
+				render.chans = golden.chans;
+				render.block = golden.block;
+				render.samples = golden.samples;
+				if (!renderSong(plugin, tune, subsong, config, &render, &pcm)) {
+					fprintf(stderr, "%s: not a tune the plugin can play\n", tune.filename.c_str());
+					failed++;
+					continue;
+				}
+				checked++;
+
+				// hashes settle bit-exact blocks, the rest are compared against the reference PCM
+				std::vector<float> reference;
+				int changedBlocks = 0;
+				int firstChanged = -1;
+				double maxDiff = 0;
+				for (size_t b = 0; b < golden.hashes.size(); b++) {
+					if (render.hashes[b] == golden.hashes[b]) {
+						continue;
+					}
+					if (reference.empty()) {
+						reference.assign(golden.samples, 0);
+						FILE* pcmfile = fopen((basename + ".pcm").c_str(), "rb");
+						if (!pcmfile || fread(reference.data(), sizeof(float), reference.size(), pcmfile) != reference.size()) {
+							// without the reference every changed block is a failure
+							std::fill(reference.begin(), reference.end(), INFINITY);
+						}
+						if (pcmfile) {
+							fclose(pcmfile);
+						}
+					}
+					changedBlocks++;
+					if (firstChanged < 0) {
+						firstChanged = (int)b;
+					}
+					const size_t blockEnd = std::min<size_t>((b + 1) * golden.block, golden.samples);
+					for (size_t i = b * golden.block; i < blockEnd; i++) {
+						maxDiff = std::max<double>(maxDiff, std::fabs((double)pcm[i] - reference[i]));
+					}
+				}
+
+				if (!changedBlocks) {
+					printf("exact     %s\n", basename.c_str());
+				} else if (maxDiff <= tolerance) {
+					printf("within    %s, %d blocks differ by at most %g\n", basename.c_str(), changedBlocks, maxDiff);
+				} else {
+					printf("FAILED    %s, %d blocks differ from %.3f s on, by up to %g\n", basename.c_str(), changedBlocks,
+						(double)firstChanged * golden.block / (golden.rate * golden.chans), maxDiff);
+					failed++;
+				}
+			}
+		}
+	}
+
+	printf("%d renders %s, %d failed\n", checked, recordDir ? "recorded" : "checked", failed);
+	return failed ? 1 : 0;
+}
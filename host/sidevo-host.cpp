@@ -0,0 +1,159 @@
+// XMPlay SIDevo headless host - play a tune through the plugin from the command line
+#include "xmphost.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+static void usage() {
+	fprintf(stderr,
+		"usage: sidevo-host [options] file.sid\n"
+		"  -s N          sub-song to play (default 1)\n"
+		"  -t SECONDS    stop after this much audio (default: when the song ends, at most 600)\n"
+		"  -f SECONDS    seek this far in before playing and time the seek, the fast-forward path\n"
+		"  -r RATE       output rate (default 44100)\n"
+		"  -c CHANS      output channels (default 2)\n"
+		"  -b SAMPLES    samples asked for per Process call (default 4096)\n"
+		"  -k KEY=VALUE  registry setting, e.g. -k c_samplemethod=Accurate -k c_enablefilter=0\n"
+		"  -o FILE       write the output as raw 32-bit float PCM\n"
+		"  -i            print the general info and message panels\n");
+}
+
+int main(int argc, char** argv) {
+	const char* filename = NULL;
+	const char* outname = NULL;
+	int subsong = 1;
+	double seconds = 600;
+	double seekSeconds = 0;
+	DWORD rate = 44100;
+	DWORD chans = 2;
+	DWORD block = 4096;
+	bool info = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+			subsong = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+			seconds = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+			seekSeconds = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+			rate = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+			chans = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+			block = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-k") && i + 1 < argc) {
+			if (!hostSetting(argv[++i])) {
+				usage();
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+			outname = argv[++i];
+		} else if (!strcmp(argv[i], "-i")) {
+			info = true;
+		} else if (argv[i][0] != '-' && !filename) {
+			filename = argv[i];
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (!filename || !block || seekSeconds < 0) {
+		usage();
+		return 1;
+	}
+
+	XMPIN* plugin = hostLoad();
+	if (!plugin) {
+		fprintf(stderr, "plugin refused the interface\n");
+		return 1;
+	}
+	HOSTsong song;
+	if (!hostOpenSong(&song, plugin, filename, rate, chans, subsong)) {
+		fprintf(stderr, "%s: not a tune the plugin can play\n", filename);
+		return 1;
+	}
+	FILE* outfile = NULL;
+	if (outname && !(outfile = fopen(outname, "wb"))) {
+		fprintf(stderr, "%s: can't write\n", outname);
+		hostCloseSong(&song);
+		return 1;
+	}
+
+	// seeking renders everything up to the new position without output, like XMPlay's seek bar
+	double seekWall = 0;
+	double seekDone = 0;
+	if (seekSeconds > 0) {
+		std::chrono::steady_clock::time_point seekStart = std::chrono::steady_clock::now();
+		seekDone = plugin->SetPosition((DWORD)(seekSeconds / plugin->GetGranularity() + 0.5));
+		seekWall = std::chrono::duration<double>(std::chrono::steady_clock::now() - seekStart).count();
+	}
+
+	// pull blocks like the XMPlay output thread until the plugin says the song is over,
+	// each call has the playing time of the block it was asked for to return in
+	std::vector<float> buffer(block);
+	const double samplelimit = seconds * song.format.rate * song.format.chan;
+	const double blockDeadline = (double)block / (song.format.rate * song.format.chan);
+	std::vector<double> latencyRatios;
+	double samples = 0;
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	while (samples < samplelimit) {
+		std::chrono::steady_clock::time_point blockStart = std::chrono::steady_clock::now();
+		DWORD done = plugin->Process(buffer.data(), block);
+		latencyRatios.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - blockStart).count() / blockDeadline);
+		if (!done) {
+			break;
+		}
+		if (outfile) {
+			fwrite(buffer.data(), sizeof(float), done, outfile);
+		}
+		samples += done;
+	}
+	double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	double audioSeconds = samples / (song.format.rate * song.format.chan);
+
+	printf("file\t%s\n", filename);
+	printf("subsong\t%d of %u\n", subsong, song.subsongs);
+	printf("format\t%u Hz, %u channels\n", song.format.rate, song.format.chan);
+	printf("length\t%.3f s%s\n", hostLength(), hostSeekable() ? "" : " (not seekable)");
+	if (seekSeconds > 0 && seekDone < 0) {
+		printf("seek\tfailed\n");
+	} else if (seekSeconds > 0) {
+		printf("seek\tto %.3f s in %.3f s (%.1fx realtime)\n", seekDone, seekWall, seekWall > 0 ? seekDone / seekWall : 0);
+	}
+	printf("rendered\t%.3f s in %.3f s (%.1fx realtime)\n", audioSeconds, wallSeconds, wallSeconds > 0 ? audioSeconds / wallSeconds : 0);
+	if (!latencyRatios.empty()) {
+		std::sort(latencyRatios.begin(), latencyRatios.end());
+		size_t misses = latencyRatios.end() - std::upper_bound(latencyRatios.begin(), latencyRatios.end(), 1.0);
+		size_t p99 = std::min(latencyRatios.size() - 1, (size_t)std::ceil(latencyRatios.size() * 0.99) - 1);
+		printf("deadline\tp50 %.1f%%, p99 %.1f%%, max %.1f%% used, missed %zu of %zu blocks\n", latencyRatios[(latencyRatios.size() - 1) / 2] * 100,
+			latencyRatios[p99] * 100, latencyRatios.back() * 100, misses, latencyRatios.size());
+	}
+	if (info) {
+		// the panels use \r between lines and \t between name and value
+		static char panel[65536];
+		panel[0] = 0;
+		plugin->GetGeneralInfo(panel);
+		for (char* ch = panel; *ch; ch++) {
+			if (*ch == '\r') *ch = '\n';
+		}
+		printf("\n%s", panel);
+		panel[0] = 0;
+		plugin->GetMessage(panel);
+		for (char* ch = panel; *ch; ch++) {
+			if (*ch == '\r') *ch = '\n';
+		}
+		printf("\n%s", panel);
+	}
+
+	if (outfile) {
+		fclose(outfile);
+	}
+	hostCloseSong(&song);
+	return 0;
+}
@@ -0,0 +1,444 @@
+// XMPlay SIDevo headless host - cost of each part of the emulation, in host time per emulated C64 cycle
+#include "synthtune.h"
+#include "recorder.h"
+#include "framestep.h"
+#include "xmp-sidevo.h"
+
+#include <sidplayfp/sidplayfp.h>
+#include <sidplayfp/SidConfig.h>
+#include <sidplayfp/SidTune.h>
+#include <residfp/SID.h>
+#include <residfp/resample/SincResampler.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define MICRO_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define MICRO_TSC
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define MICRO_PERF
+#endif
+
+#define MICRO_CHUNK 65536
+// cycles between two looks at the envelopes when measuring idle voices
+#define MICRO_IDLESTEP 32
+
+using libsidplayfp::event_clock_t;
+
+typedef struct
+{
+	const char* name;
+	const char* covers;
+	int base;
+	double cycles;
+	double seconds;
+	double ticks;
+	double misses;
+} MICROresult;
+
+// wall time and, on x86, time stamp counter ticks of one stage
+typedef struct
+{
+	std::chrono::steady_clock::time_point wallStart;
+	unsigned long long tickStart;
+} MICROtimer;
+
+// last level cache misses of this thread, where the kernel lets us count them
+static int missCounter = -1;
+static void openMisscounter() {
+#ifdef MICRO_PERF
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_CACHE_MISSES;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	missCounter = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+}
+
+static void startTimer(MICROtimer* timer) {
+#ifdef MICRO_PERF
+	if (missCounter >= 0) {
+		ioctl(missCounter, PERF_EVENT_IOC_RESET, 0);
+		ioctl(missCounter, PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+#ifdef MICRO_TSC
+	timer->tickStart = __rdtsc();
+#else
+	timer->tickStart = 0;
+#endif
+	timer->wallStart = std::chrono::steady_clock::now();
+}
+static void stopTimer(const MICROtimer* timer, MICROresult* result) {
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timer->wallStart).count();
+#ifdef MICRO_TSC
+	double ticks = (double)(__rdtsc() - timer->tickStart);
+#else
+	double ticks = 0;
+#endif
+	double misses = -1;
+#ifdef MICRO_PERF
+	long long missCount;
+	if (missCounter >= 0) {
+		ioctl(missCounter, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(missCounter, &missCount, sizeof(missCount)) == sizeof(missCount)) {
+			misses = (double)missCount;
+		}
+	}
+#endif
+	// repeated runs keep the fastest, the others only measured interference
+	if (result->seconds == 0 || seconds < result->seconds) {
+		result->seconds = seconds;
+		result->ticks = ticks;
+		result->misses = misses;
+	}
+}
+
+static void usage() {
+	fprintf(stderr,
+		"usage: sidevo-micro [options] [tune.sid]\n"
+		"  -t SECONDS    emulated time per stage (default 30)\n"
+		"  -r RATE       output rate for the SID stages (default 44100)\n"
+		"  -i RUNS       runs per stage, the fastest counts (default 3)\n"
+		"  -n            NTSC clock instead of PAL\n"
+		"  -u SUBSONG    sub-song of the tune given (default 1)\n"
+		"  -R            the synthetic interrupt driven RSID instead, for the scheduler and CIA cost\n"
+		"  a tune given replaces the synthetic 1 SID tune, sparse real tunes show how much idle voices could save\n");
+}
+
+// the machine without a SID: 6510, CIAs, VIC and the event scheduler running the player,
+// the register writes it makes are kept to drive the SID stages with
+static bool benchMachine(MICROresult* result, std::vector<SIDwrite>* writes, double* cpuFreq, const std::vector<uint8_t>& tuneData, int subsong,
+	double seconds, bool ntsc, int runs) {
+	for (int run = 0; run < runs; run++) {
+		RecorderBuilder microBuilder("Recorder");
+		sidplayfp microEngine;
+		microEngine.setRoms(kernel, basic, chargen);
+		microBuilder.create(microEngine.info().maxsids());
+
+		SidConfig microConfig = microEngine.config();
+		microConfig.frequency = 44100;
+		microConfig.playback = SidConfig::MONO;
+		microConfig.powerOnDelay = 0;
+		microConfig.defaultC64Model = ntsc ? SidConfig::NTSC : SidConfig::PAL;
+		microConfig.forceC64Model = true;
+		microConfig.sidEmulation = &microBuilder;
+		SidTune microSong(tuneData.data(), (uint_least32_t)tuneData.size());
+		if (!microBuilder.getStatus() || !microEngine.config(microConfig) || !microSong.getStatus()) {
+			fprintf(stderr, "machine: %s\n", microEngine.error());
+			return false;
+		}
+		microSong.selectSong(subsong);
+		if (!microEngine.load(&microSong)) {
+			fprintf(stderr, "machine: %s\n", microEngine.error());
+			return false;
+		}
+
+		MICROtimer timer;
+		startTimer(&timer);
+		while (microEngine.timeMs() < seconds * 1000) {
+			microEngine.play(nullptr, 0);
+		}
+		stopTimer(&timer, result);
+
+		*cpuFreq = microBuilder.cpuFreq > 0 ? microBuilder.cpuFreq : (ntsc ? 1022727.0 : 985248.0);
+		result->cycles = microEngine.timeMs() * *cpuFreq / 1000;
+		writes->swap(microBuilder.writes);
+	}
+	return true;
+}
+
+// the same tune on the frame stepper, a bare 6510 on flat memory called once a frame with no VIC, CIA or
+// scheduler, false when the tune needs the full machine
+static bool benchFramestep(MICROresult* result, const std::vector<uint8_t>& tuneData, int subsong, double cpuFreq, double seconds, int runs) {
+	for (int run = 0; run < runs; run++) {
+		SIDframestep microStep;
+		if (!microStep.load(tuneData, subsong, cpuFreq)) {
+			return false;
+		}
+		std::vector<SIDwrite> stepWrites;
+		const event_clock_t stepEnd = (event_clock_t)(seconds * cpuFreq);
+
+		MICROtimer timer;
+		startTimer(&timer);
+		while (microStep.clock < stepEnd) {
+			if (!microStep.frame(stepWrites)) {
+				return false;
+			}
+			stepWrites.clear();
+		}
+		stopTimer(&timer, result);
+		result->cycles = (double)microStep.clock;
+	}
+	return true;
+}
+
+// reSIDfp chips replaying the recorded writes at their original clocks, clocked in runs of at most
+// slice cycles between two writes; more than one chip all get the same writes, like a 2SID or 3SID tune
+static void benchChip(MICROresult* result, const std::vector<SIDwrite>& writes, double cpuFreq, double rate, int runs,
+	reSIDfp::ChipModel model, bool filter, reSIDfp::SamplingMethod method, unsigned int slice = MICRO_CHUNK, int chips = 1) {
+	std::vector<short> buffer(MICRO_CHUNK);
+	for (int run = 0; run < runs; run++) {
+		std::vector<std::unique_ptr<reSIDfp::SID>> microSids;
+		for (int chip = 0; chip < chips; chip++) {
+			microSids.emplace_back(new reSIDfp::SID());
+			microSids.back()->setChipModel(model);
+			microSids.back()->setSamplingParameters(cpuFreq, method, rate);
+			microSids.back()->enableFilter(filter);
+		}
+
+		event_clock_t now = 0;
+		MICROtimer timer;
+		startTimer(&timer);
+		for (const SIDwrite& busWrite : writes) {
+			while (now < busWrite.clock) {
+				unsigned int cycles = (unsigned int)std::min<event_clock_t>(busWrite.clock - now, slice);
+				for (std::unique_ptr<reSIDfp::SID>& microSid : microSids) {
+					microSid->clock(cycles, buffer.data());
+				}
+				now += cycles;
+			}
+			for (std::unique_ptr<reSIDfp::SID>& microSid : microSids) {
+				microSid->write(busWrite.addr, busWrite.data);
+			}
+		}
+		stopTimer(&timer, result);
+		result->cycles = (double)now;
+	}
+}
+
+// share of the time each voice is provably silent, gate off with the envelope run down to zero, where
+// clocking it could be skipped until the next write; bit v of a slice's mask is set while voice v idles
+static void idleVoices(const std::vector<SIDwrite>& writes, int chip, double cpuFreq, double rate, std::vector<uint8_t>* idleMask) {
+	std::vector<short> buffer(MICRO_CHUNK);
+	idleMask->clear();
+	for (int voice = 0; voice < 3; voice++) {
+		// the voice is replayed as voice 3, the only one whose envelope can be read back
+		reSIDfp::SID microSid;
+		microSid.setSamplingParameters(cpuFreq, reSIDfp::DECIMATE, rate);
+		microSid.enableFilter(false);
+		bool gate = false;
+		event_clock_t now = 0;
+		size_t slice = 0;
+		std::vector<SIDwrite>::const_iterator busWrite = writes.begin();
+		while (busWrite != writes.end()) {
+			const event_clock_t sliceEnd = now + MICRO_IDLESTEP;
+			for (; busWrite != writes.end() && busWrite->clock < sliceEnd; ++busWrite) {
+				if (busWrite->chip != chip || busWrite->addr < voice * 7 || busWrite->addr >= voice * 7 + 7) {
+					continue;
+				}
+				if (busWrite->clock > now) {
+					microSid.clock((unsigned int)(busWrite->clock - now), buffer.data());
+					now = busWrite->clock;
+				}
+				microSid.write(busWrite->addr - voice * 7 + 14, busWrite->data);
+				if (busWrite->addr == voice * 7 + 4) {
+					gate = (busWrite->data & 1) != 0;
+				}
+			}
+			microSid.clock((unsigned int)(sliceEnd - now), buffer.data());
+			now = sliceEnd;
+			if (slice >= idleMask->size()) {
+				idleMask->push_back(0);
+			}
+			if (!gate && microSid.read(0x1c) == 0) {
+				(*idleMask)[slice] |= 1 << voice;
+			}
+			slice++;
+		}
+	}
+}
+
+// the sinc resampler on its own, fed one sample per C64 cycle
+static void benchResampler(MICROresult* result, double cycles, double cpuFreq, double rate, int runs) {
+	volatile int outputSink = 0;
+	for (int run = 0; run < runs; run++) {
+		reSIDfp::SincResampler microResampler(cpuFreq, rate, 20000.);
+		int produced = 0;
+		const long long inputCycles = (long long)cycles;
+
+		MICROtimer timer;
+		startTimer(&timer);
+		for (long long cycle = 0; cycle < inputCycles; cycle++) {
+			// a sawtooth with a bit of noise, the filter does the same work whatever the input is
+			int sample = (int)((cycle * 37) & 0x7fff) - 16384 + (int)((cycle * 2654435761u) >> 28);
+			if (microResampler.input(sample)) {
+				produced += microResampler.output();
+			}
+		}
+		stopTimer(&timer, result);
+		outputSink = outputSink + produced;
+		result->cycles = (double)inputCycles;
+	}
+}
+
+int main(int argc, char** argv) {
+	double seconds = 30;
+	double rate = 44100;
+	int runs = 3;
+	bool ntsc = false;
+	int subsong = 1;
+	const char* tuneName = NULL;
+	bool rsid = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+			seconds = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+			rate = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+			runs = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-n")) {
+			ntsc = true;
+		} else if (!strcmp(argv[i], "-u") && i + 1 < argc) {
+			subsong = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-R")) {
+			rsid = true;
+		} else if (argv[i][0] != '-' && !tuneName) {
+			tuneName = argv[i];
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (seconds <= 0 || rate <= 0 || runs < 1 || subsong < 1) {
+		usage();
+		return 1;
+	}
+	std::vector<uint8_t> tuneData;
+	if (tuneName) {
+		FILE* tunefile = fopen(tuneName, "rb");
+		if (!tunefile) {
+			fprintf(stderr, "%s: can't read\n", tuneName);
+			return 1;
+		}
+		uint8_t chunk[4096];
+		size_t got;
+		while ((got = fread(chunk, 1, sizeof(chunk), tunefile)) > 0) {
+			tuneData.insert(tuneData.end(), chunk, chunk + got);
+		}
+		fclose(tunefile);
+	} else if (rsid) {
+		tuneData = synthRsid();
+	} else {
+		tuneData = synthTune(1);
+	}
+
+	// each stage adds one part to the one it is based on, the difference is what that part costs
+	MICROresult results[] = {
+		{ "machine", "mos6510, EventScheduler, CIA, VIC", -1 },
+		{ "voices 6581", "WaveformGenerator, EnvelopeGenerator, DAC", -1 },
+		{ "voices 8580", "WaveformGenerator, EnvelopeGenerator, DAC", -1 },
+		{ "filter 6581", "Filter6581, Integrator6581", 1 },
+		{ "filter 8580", "Filter8580, Integrator8580", 2 },
+		{ "resample 6581", "TwoPassSincResampler", 3 },
+		{ "resample 8580", "TwoPassSincResampler", 4 },
+		{ "sinc alone", "SincResampler, single pass", -1 },
+		// the stages above clock straight from one write to the next, these cut the same runs shorter
+		{ "slice 5000", "SID::clock per mixer run, as libsidplayfp batches it", 1 },
+		{ "slice 64", "SID::clock every 64 cycles", 1 },
+		{ "slice 1", "SID::clock every cycle", 1 },
+		{ "voices 3 chips", "nine voices, the working set of a 3SID tune", 1 },
+		// the machine stage again with only the CPU, what a VIC and CIA that cost nothing would leave
+		{ "frame-stepped", "6510 on flat memory, play once a frame", -1 },
+	};
+
+	openMisscounter();
+	std::vector<SIDwrite> writes;
+	double cpuFreq = 0;
+	if (!benchMachine(&results[0], &writes, &cpuFreq, tuneData, subsong, seconds, ntsc, runs)) {
+		return 1;
+	}
+	int chips = 1;
+	for (const SIDwrite& busWrite : writes) {
+		chips = std::max<int>(chips, busWrite.chip + 1);
+	}
+	std::vector<std::vector<uint8_t>> idleMasks(chips);
+	for (int chip = 0; chip < chips; chip++) {
+		idleVoices(writes, chip, cpuFreq, rate, &idleMasks[chip]);
+	}
+	writes.erase(std::remove_if(writes.begin(), writes.end(), [](const SIDwrite& busWrite) { return busWrite.chip != 0; }), writes.end());
+
+	benchChip(&results[1], writes, cpuFreq, rate, runs, reSIDfp::MOS6581, false, reSIDfp::DECIMATE);
+	benchChip(&results[2], writes, cpuFreq, rate, runs, reSIDfp::MOS8580, false, reSIDfp::DECIMATE);
+	benchChip(&results[3], writes, cpuFreq, rate, runs, reSIDfp::MOS6581, true, reSIDfp::DECIMATE);
+	benchChip(&results[4], writes, cpuFreq, rate, runs, reSIDfp::MOS8580, true, reSIDfp::DECIMATE);
+	benchChip(&results[5], writes, cpuFreq, rate, runs, reSIDfp::MOS6581, true, reSIDfp::RESAMPLE);
+	benchChip(&results[6], writes, cpuFreq, rate, runs, reSIDfp::MOS8580, true, reSIDfp::RESAMPLE);
+	benchResampler(&results[7], results[0].cycles, cpuFreq, rate, runs);
+	benchChip(&results[8], writes, cpuFreq, rate, runs, reSIDfp::MOS6581, false, reSIDfp::DECIMATE, 5000);
+	benchChip(&results[9], writes, cpuFreq, rate, runs, reSIDfp::MOS6581, false, reSIDfp::DECIMATE, 64);
+	benchChip(&results[10], writes, cpuFreq, rate, runs, reSIDfp::MOS6581, false, reSIDfp::DECIMATE, 1);
+	benchChip(&results[11], writes, cpuFreq, rate, runs, reSIDfp::MOS6581, false, reSIDfp::DECIMATE, MICRO_CHUNK, 3);
+	const bool stepped = benchFramestep(&results[12], tuneData, subsong, cpuFreq, seconds, runs);
+
+	printf("%.0f Hz %s clock, %.0f Hz output, %.0f s emulated, %zu register writes, fastest of %d\n\n",
+		cpuFreq, ntsc ? "NTSC" : "PAL", rate, seconds, writes.size(), runs);
+	printf("%-14s %10s %10s %10s %10s   %s\n", "stage", "ns/cycle", "tsc/cycle", "adds ns", "miss/kcyc", "covers");
+	for (const MICROresult& result : results) {
+		double nsCycle = result.cycles > 0 ? result.seconds * 1e9 / result.cycles : 0;
+		double ticksCycle = result.cycles > 0 ? result.ticks / result.cycles : 0;
+		char adds[16] = "";
+		char misses[16] = "-";
+		if (result.base >= 0) {
+			const MICROresult& base = results[result.base];
+			double baseCycle = base.cycles > 0 ? base.seconds * 1e9 / base.cycles : 0;
+			snprintf(adds, sizeof(adds), "%.2f", nsCycle - baseCycle);
+		}
+		if (result.misses >= 0 && result.cycles > 0) {
+			snprintf(misses, sizeof(misses), "%.2f", result.misses * 1000 / result.cycles);
+		}
+		printf("%-14s %10.2f %10.1f %10s %10s   %s\n", result.name, nsCycle, ticksCycle, adds, misses, result.covers);
+	}
+
+	printf("\n%-14s %10s %10s %10s %10s\n", "idle", "voice 1", "voice 2", "voice 3", "chip");
+	double chip0Idle = 0;
+	for (int chip = 0; chip < chips; chip++) {
+		const std::vector<uint8_t>& idleMask = idleMasks[chip];
+		double slices = std::max<double>((double)idleMask.size(), 1);
+		double voiceIdle[3] = { 0, 0, 0 };
+		double chipIdle = 0;
+		for (uint8_t mask : idleMask) {
+			for (int voice = 0; voice < 3; voice++) {
+				voiceIdle[voice] += (mask >> voice) & 1;
+			}
+			chipIdle += mask == 7;
+		}
+		printf("chip %-9d %9.1f%% %9.1f%% %9.1f%% %9.1f%%\n", chip + 1, voiceIdle[0] * 100 / slices, voiceIdle[1] * 100 / slices,
+			voiceIdle[2] * 100 / slices, chipIdle * 100 / slices);
+		if (chip == 0) {
+			chip0Idle = (voiceIdle[0] + voiceIdle[1] + voiceIdle[2]) / (3 * slices);
+		}
+	}
+	// the voices stage without its share of idle voice time is the most skipping them could save
+	const double voicesCycle = results[1].cycles > 0 ? results[1].seconds * 1e9 / results[1].cycles : 0;
+	printf("skipping idle voices could save up to %.2f of the %.2f ns/cycle the 6581 voices cost\n", voicesCycle * chip0Idle, voicesCycle);
+	// everything the machine stage spends on top of the frame stepper is VIC, CIA, scheduling and bus timing
+	const double machineCycle = results[0].cycles > 0 ? results[0].seconds * 1e9 / results[0].cycles : 0;
+	if (stepped && results[12].cycles > 0) {
+		const double stepCycle = results[12].seconds * 1e9 / results[12].cycles;
+		printf("frame stepping saves %.2f of the %.2f ns/cycle the machine costs (%.1fx)\n", machineCycle - stepCycle, machineCycle,
+			stepCycle > 0 ? machineCycle / stepCycle : 0);
+	} else {
+		printf("this tune can't be frame-stepped, it needs the VIC, the CIAs or the ROMs\n");
+	}
+	return 0;
+}
@@ -0,0 +1,231 @@
+// XMPlay SIDevo headless host - synthetic PSID tunes for benchmarks and regression checks
+#include "synthtune.h"
+
+#include <string.h>
+
+// just the 6510 opcodes the tunes need
+static void emitByte(std::vector<uint8_t>& code, uint8_t value) {
+	code.push_back(value);
+}
+static void emitAbs(std::vector<uint8_t>& code, uint8_t opcode, uint16_t addr) {
+	code.push_back(opcode);
+	code.push_back(addr & 0xff);
+	code.push_back(addr >> 8);
+}
+static void ldaImm(std::vector<uint8_t>& code, uint8_t value) {
+	emitByte(code, 0xa9);
+	emitByte(code, value);
+}
+static void staAbs(std::vector<uint8_t>& code, uint16_t addr) {
+	emitAbs(code, 0x8d, addr);
+}
+
+std::vector<uint8_t> synthTune(int sids, int subsongs) {
+	const uint16_t loadAddr = 0x1000;
+	const uint16_t sidBase[3] = { 0xd400, 0xd420, 0xd440 };
+	const uint8_t voiceWave[3] = { 0x41, 0x21, 0x11 };
+	if (sids < 1) sids = 1;
+	if (sids > 3) sids = 3;
+
+	// $1000 jmp init, $1003 jmp play, counter byte after the code
+	std::vector<uint8_t> code;
+	emitAbs(code, 0x4c, 0);
+	emitAbs(code, 0x4c, 0);
+
+	// init, the sub-song number in A picks the filter mode so sub-songs sound different
+	const uint16_t initAddr = loadAddr + (uint16_t)code.size();
+	emitByte(code, 0x0a); // asl
+	emitByte(code, 0x0a); // asl
+	emitByte(code, 0x0a); // asl
+	emitByte(code, 0x0a); // asl
+	emitByte(code, 0x18); // clc
+	emitByte(code, 0x69); // adc #$10, sub-song 1 gets low-pass
+	emitByte(code, 0x10);
+	emitByte(code, 0x29); // and #$70
+	emitByte(code, 0x70);
+	emitByte(code, 0x09); // ora #$0f
+	emitByte(code, 0x0f);
+	for (int sid = 0; sid < sids; sid++) {
+		staAbs(code, sidBase[sid] + 0x18);
+	}
+	for (int sid = 0; sid < sids; sid++) {
+		ldaImm(code, 0xf7);
+		staAbs(code, sidBase[sid] + 0x17);
+		ldaImm(code, 0x40);
+		staAbs(code, sidBase[sid] + 0x16);
+		for (int v = 0; v < 3; v++) {
+			const uint16_t voice = sidBase[sid] + v * 7;
+			ldaImm(code, 0x09);
+			staAbs(code, voice + 5);
+			ldaImm(code, 0xa8);
+			staAbs(code, voice + 6);
+			ldaImm(code, 0x08);
+			staAbs(code, voice + 3);
+			ldaImm(code, (uint8_t)(0x10 + sid * 0x18 + v * 0x08));
+			staAbs(code, voice + 1);
+			ldaImm(code, voiceWave[v]);
+			staAbs(code, voice + 4);
+		}
+	}
+	emitByte(code, 0x60); // rts
+
+	// play, sweep pitch, pulse width and cutoff every frame and retrigger the gates every 32 frames
+	const uint16_t playAddr = loadAddr + (uint16_t)code.size();
+	std::vector<size_t> counterRefs;
+	counterRefs.push_back(code.size() + 1);
+	emitAbs(code, 0xee, 0); // inc counter
+	counterRefs.push_back(code.size() + 1);
+	emitAbs(code, 0xad, 0); // lda counter
+	for (int sid = 0; sid < sids; sid++) {
+		staAbs(code, sidBase[sid] + 0x00);
+		staAbs(code, sidBase[sid] + 0x16);
+		staAbs(code, sidBase[sid] + 0x0a);
+		emitByte(code, 0x49); // eor #$55
+		emitByte(code, 0x55);
+		staAbs(code, sidBase[sid] + 0x07);
+		staAbs(code, sidBase[sid] + 0x11);
+		emitByte(code, 0x49); // eor #$55
+		emitByte(code, 0x55);
+	}
+	emitByte(code, 0x29); // and #$1f
+	emitByte(code, 0x1f);
+	// 3 SIDs of retriggers is 90 bytes, still within branch range
+	const size_t retriggerBranch = code.size();
+	emitByte(code, 0xd0); // bne done
+	emitByte(code, 0x00);
+	for (int sid = 0; sid < sids; sid++) {
+		for (int v = 0; v < 3; v++) {
+			const uint16_t voice = sidBase[sid] + v * 7;
+			ldaImm(code, voiceWave[v] & 0xfe);
+			staAbs(code, voice + 4);
+			ldaImm(code, voiceWave[v]);
+			staAbs(code, voice + 4);
+		}
+	}
+	code[retriggerBranch + 1] = (uint8_t)(code.size() - (retriggerBranch + 2));
+	emitByte(code, 0x60); // rts
+
+	const uint16_t counterAddr = loadAddr + (uint16_t)code.size();
+	emitByte(code, 0x00);
+	for (size_t ref : counterRefs) {
+		code[ref] = counterAddr & 0xff;
+		code[ref + 1] = counterAddr >> 8;
+	}
+	code[1] = initAddr & 0xff;
+	code[2] = initAddr >> 8;
+	code[4] = playAddr & 0xff;
+	code[5] = playAddr >> 8;
+
+	// PSID v2 header, v3 and v4 add the second and third SID
+	std::vector<uint8_t> tune(0x7c, 0);
+	memcpy(tune.data(), "PSID", 4);
+	tune[0x05] = (uint8_t)(sids == 1 ? 2 : sids + 1);
+	tune[0x07] = 0x7c;
+	tune[0x08] = loadAddr >> 8;
+	tune[0x09] = loadAddr & 0xff;
+	tune[0x0a] = loadAddr >> 8;
+	tune[0x0b] = loadAddr & 0xff;
+	tune[0x0c] = (loadAddr + 3) >> 8;
+	tune[0x0d] = (loadAddr + 3) & 0xff;
+	tune[0x0f] = (uint8_t)subsongs;
+	tune[0x11] = 1;
+	const char* tuneName = sids == 1 ? "SIDevo synthetic 1SID" : sids == 2 ? "SIDevo synthetic 2SID" : "SIDevo synthetic 3SID";
+	strncpy((char*)tune.data() + 0x16, tuneName, 31);
+	strncpy((char*)tune.data() + 0x36, "SIDevo", 31);
+	strncpy((char*)tune.data() + 0x56, "Public Domain", 31);
+	// C64 compatible, any clock, any model for every SID
+	tune[0x76] = 0x03;
+	tune[0x77] = 0xfc;
+	if (sids >= 2) {
+		tune[0x7a] = 0x42;
+	}
+	if (sids >= 3) {
+		tune[0x7b] = 0x44;
+	}
+	tune.insert(tune.end(), code.begin(), code.end());
+	return tune;
+}
+
+std::vector<uint8_t> synthRsid() {
+	const uint16_t loadAddr = 0x1000;
+	// PAL clock over about 8 kHz
+	const uint16_t timerPeriod = 123;
+
+	// init, one voice sounding under the digi, the interrupt hooked in through the KERNAL vector
+	std::vector<uint8_t> code;
+	emitByte(code, 0x78); // sei
+	ldaImm(code, 0x0f);
+	staAbs(code, 0xd418);
+	ldaImm(code, 0x09);
+	staAbs(code, 0xd405);
+	ldaImm(code, 0xa8);
+	staAbs(code, 0xd406);
+	ldaImm(code, 0x08);
+	staAbs(code, 0xd403);
+	ldaImm(code, 0x10);
+	staAbs(code, 0xd401);
+	ldaImm(code, 0x41);
+	staAbs(code, 0xd404);
+	const size_t vectorLow = code.size() + 1;
+	ldaImm(code, 0);
+	staAbs(code, 0x0314);
+	const size_t vectorHigh = code.size() + 1;
+	ldaImm(code, 0);
+	staAbs(code, 0x0315);
+	ldaImm(code, timerPeriod & 0xff);
+	staAbs(code, 0xdc04);
+	ldaImm(code, timerPeriod >> 8);
+	staAbs(code, 0xdc05);
+	ldaImm(code, 0x7f); // no other CIA 1 interrupts
+	staAbs(code, 0xdc0d);
+	ldaImm(code, 0x81); // timer A interrupt
+	staAbs(code, 0xdc0d);
+	ldaImm(code, 0x11); // start timer A, continuous
+	staAbs(code, 0xdc0e);
+	emitAbs(code, 0xad, 0xdc0d); // lda $dc0d, drop anything pending
+	emitByte(code, 0x58); // cli
+	// spin forever, an RSID init needn't return
+	const uint16_t loopAddr = loadAddr + (uint16_t)code.size();
+	emitAbs(code, 0x4c, loopAddr);
+
+	// interrupt, the next volume step, acknowledge and leave through the KERNAL's register restore
+	const uint16_t irqAddr = loadAddr + (uint16_t)code.size();
+	std::vector<size_t> counterRefs;
+	counterRefs.push_back(code.size() + 1);
+	emitAbs(code, 0xee, 0); // inc counter
+	counterRefs.push_back(code.size() + 1);
+	emitAbs(code, 0xad, 0); // lda counter
+	emitByte(code, 0x29); // and #$0f
+	emitByte(code, 0x0f);
+	staAbs(code, 0xd418);
+	emitAbs(code, 0xad, 0xdc0d); // lda $dc0d
+	emitAbs(code, 0x4c, 0xea81); // jmp $ea81
+
+	const uint16_t counterAddr = loadAddr + (uint16_t)code.size();
+	emitByte(code, 0x00);
+	for (size_t ref : counterRefs) {
+		code[ref] = counterAddr & 0xff;
+		code[ref + 1] = counterAddr >> 8;
+	}
+	code[vectorLow] = irqAddr & 0xff;
+	code[vectorHigh] = irqAddr >> 8;
+
+	// RSID v2 header, the load address is the first two bytes of the data and there is no play address
+	std::vector<uint8_t> tune(0x7c, 0);
+	memcpy(tune.data(), "RSID", 4);
+	tune[0x05] = 2;
+	tune[0x07] = 0x7c;
+	tune[0x0a] = loadAddr >> 8;
+	tune[0x0b] = loadAddr & 0xff;
+	tune[0x0f] = 1;
+	tune[0x11] = 1;
+	strncpy((char*)tune.data() + 0x16, "SIDevo synthetic RSID", 31);
+	strncpy((char*)tune.data() + 0x36, "SIDevo", 31);
+	strncpy((char*)tune.data() + 0x56, "Public Domain", 31);
+	// any clock, any SID model
+	tune[0x77] = 0x3c;
+	tune.push_back(loadAddr & 0xff);
+	tune.push_back(loadAddr >> 8);
+	tune.insert(tune.end(), code.begin(), code.end());
+	return tune;
+}
@@ -0,0 +1,12 @@
+// XMPlay SIDevo headless host - synthetic PSID tunes for benchmarks and regression checks
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// a PSID for 1 to 3 SIDs with every voice sounding, filter routed and registers swept each frame,
+// clock and SID model are left as "any" so the settings decide them
+std::vector<uint8_t> synthTune(int sids, int subsongs = 1);
+// an RSID that plays a 4-bit digi from a CIA 1 timer interrupt about 8000 times a second while the main
+// program spins, the C64 side does far more scheduling work than a frame-driven PSID
+std::vector<uint8_t> synthRsid();
@@ -0,0 +1,285 @@
+// XMPlay SIDevo headless host - stands in for XMPlay so the plugin can be driven without it
+#include "xmphost.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+
+#ifdef __cplusplus
+extern "C"
+#endif
+XMPIN* WINAPI XMPIN_GetInterface(DWORD face, InterfaceProc faceproc);
+#ifdef __cplusplus
+extern "C"
+#endif
+void WINAPI XMPIN_Reconfigure();
+#ifdef __cplusplus
+extern "C"
+#endif
+void WINAPI XMPIN_Shutdown();
+
+// in-memory registry, nothing is persisted between runs
+static std::map<std::string, int> hostInts;
+static std::map<std::string, std::string> hostStrings;
+// generated tunes, opened by name as if they were files
+static std::map<std::string, std::vector<uint8_t>> hostMemoryfiles;
+
+// state reported back by the plugin
+static float hostSetlength = -1;
+static BOOL hostSetseekable = FALSE;
+static int hostUpdates = 0;
+
+void hostSetting(const char* key, int value) {
+	hostInts[key] = value;
+}
+void hostSetting(const char* key, const char* value) {
+	hostStrings[key] = value;
+}
+bool hostSetting(const char* keyValue) {
+	const char* equalPos = strchr(keyValue, '=');
+	if (!equalPos || equalPos == keyValue) {
+		return false;
+	}
+	std::string key(keyValue, equalPos - keyValue);
+	char* numberEnd;
+	long number = strtol(equalPos + 1, &numberEnd, 10);
+	if (equalPos[1] && !*numberEnd) {
+		hostSetting(key.c_str(), (int)number);
+	} else {
+		hostSetting(key.c_str(), equalPos + 1);
+	}
+	return true;
+}
+
+// XMPFUNC_IN
+static void WINAPI hostSetLength(float length, BOOL seekable) {
+	hostSetlength = length;
+	hostSetseekable = seekable;
+}
+static BOOL WINAPI hostUpdateTitle(const char* title) {
+	hostUpdates++;
+	return TRUE;
+}
+
+// XMPFUNC_MISC
+static void* WINAPI hostAlloc(DWORD len) {
+	return malloc(len ? len : 1);
+}
+static void WINAPI hostFree(void* mem) {
+	free(mem);
+}
+static char* WINAPI hostFormatInfoText(char* buf, const char* name, const char* value) {
+	return buf + sprintf(buf, "%s\t%s\r", name, value);
+}
+
+// XMPFUNC_FILE
+static DWORD WINAPI hostGetSize(XMPFILE file) {
+	return (DWORD)((HOSTfile*)file)->data.size();
+}
+static DWORD WINAPI hostRead(XMPFILE file, void* buf, DWORD len) {
+	HOSTfile* hostFile = (HOSTfile*)file;
+	DWORD readLength = std::min<DWORD>(len, (DWORD)hostFile->data.size() - hostFile->pos);
+	memcpy(buf, hostFile->data.data() + hostFile->pos, readLength);
+	hostFile->pos += readLength;
+	return readLength;
+}
+static BOOL WINAPI hostSeek(XMPFILE file, DWORD pos) {
+	HOSTfile* hostFile = (HOSTfile*)file;
+	if (pos > hostFile->data.size()) {
+		return FALSE;
+	}
+	hostFile->pos = pos;
+	return TRUE;
+}
+
+// XMPFUNC_TEXT, tags are Latin-1 so widen them to UTF-8
+static char* WINAPI hostUtf8(const char* text, int len) {
+	if (len < 0) {
+		len = (int)strlen(text);
+	}
+	char* utf8 = (char*)hostAlloc(len * 2 + 1);
+	char* out = utf8;
+	for (int i = 0; i < len; i++) {
+		unsigned char ch = (unsigned char)text[i];
+		if (ch < 0x80) {
+			*out++ = ch;
+		} else {
+			*out++ = 0xc0 | (ch >> 6);
+			*out++ = 0x80 | (ch & 0x3f);
+		}
+	}
+	*out = 0;
+	return utf8;
+}
+
+// XMPFUNC_REGISTRY
+static DWORD WINAPI hostSetString(const char* section, const char* key, const char* data) {
+	hostStrings[key] = data;
+	return 1;
+}
+static DWORD WINAPI hostGetString(const char* section, const char* key, char* data, DWORD size) {
+	std::map<std::string, std::string>::iterator entry = hostStrings.find(key);
+	if (entry == hostStrings.end() || !size) {
+		return 0;
+	}
+	strncpy(data, entry->second.c_str(), size - 1);
+	data[size - 1] = 0;
+	return (DWORD)strlen(data);
+}
+static DWORD WINAPI hostSetInt(const char* section, const char* key, const int* data) {
+	hostInts[key] = *data;
+	return 1;
+}
+static DWORD WINAPI hostGetInt(const char* section, const char* key, int* data) {
+	std::map<std::string, int>::iterator entry = hostInts.find(key);
+	if (entry == hostInts.end()) {
+		return 0;
+	}
+	*data = entry->second;
+	return 1;
+}
+
+static XMPFUNC_IN hostFuncIn;
+static XMPFUNC_MISC hostFuncMisc;
+static XMPFUNC_FILE hostFuncFile;
+static XMPFUNC_TEXT hostFuncText;
+static XMPFUNC_REGISTRY hostFuncRegistry;
+
+static void* WINAPI hostFace(DWORD face) {
+	switch (face) {
+	case XMPFUNC_IN_FACE:
+		return &hostFuncIn;
+	case XMPFUNC_MISC_FACE:
+		return &hostFuncMisc;
+	case XMPFUNC_FILE_FACE:
+		return &hostFuncFile;
+	case XMPFUNC_TEXT_FACE:
+		return &hostFuncText;
+	case XMPFUNC_REGISTRY_FACE:
+		return &hostFuncRegistry;
+	}
+	return NULL;
+}
+
+XMPIN* hostLoad() {
+	// only what the plugin calls is filled in, anything else stays NULL
+	hostFuncIn.SetLength = hostSetLength;
+	hostFuncIn.UpdateTitle = hostUpdateTitle;
+	hostFuncMisc.Alloc = hostAlloc;
+	hostFuncMisc.Free = hostFree;
+	hostFuncMisc.FormatInfoText = hostFormatInfoText;
+	hostFuncFile.GetSize = hostGetSize;
+	hostFuncFile.Read = hostRead;
+	hostFuncFile.Seek = hostSeek;
+	hostFuncText.Utf8 = hostUtf8;
+	hostFuncRegistry.SetString = hostSetString;
+	hostFuncRegistry.GetString = hostGetString;
+	hostFuncRegistry.SetInt = hostSetInt;
+	hostFuncRegistry.GetInt = hostGetInt;
+
+	// the plugin only takes its defaults when the registry has never been written
+	if (!hostStrings.count("c_sidmodel")) {
+		hostSetting("c_sidmodel", "6581");
+	}
+	// the workers are stopped before static destruction, like XMPlay never unloads a plugin with one running
+	static bool hostShutdown = false;
+	if (!hostShutdown) {
+		hostShutdown = atexit(hostUnload) == 0;
+	}
+	return XMPIN_GetInterface(XMPIN_FACE, hostFace);
+}
+void hostUnload() {
+	XMPIN_Shutdown();
+}
+void hostReconfigure() {
+	XMPIN_Reconfigure();
+}
+
+void hostAddFile(const char* filename, const std::vector<uint8_t>& data) {
+	hostMemoryfiles[filename] = data;
+}
+HOSTfile* hostOpenFile(const char* filename) {
+	std::map<std::string, std::vector<uint8_t>>::iterator memoryFile = hostMemoryfiles.find(filename);
+	if (memoryFile != hostMemoryfiles.end()) {
+		HOSTfile* hostFile = new HOSTfile;
+		hostFile->filename = filename;
+		hostFile->data = memoryFile->second;
+		hostFile->pos = 0;
+		return hostFile;
+	}
+	FILE* file = fopen(filename, "rb");
+	if (!file) {
+		return NULL;
+	}
+	HOSTfile* hostFile = new HOSTfile;
+	hostFile->filename = filename;
+	hostFile->pos = 0;
+	uint8_t readBuffer[16384];
+	size_t readLength;
+	while ((readLength = fread(readBuffer, 1, sizeof(readBuffer), file)) > 0) {
+		hostFile->data.insert(hostFile->data.end(), readBuffer, readBuffer + readLength);
+	}
+	fclose(file);
+	return hostFile;
+}
+void hostCloseFile(HOSTfile* file) {
+	delete file;
+}
+
+bool hostOpenSong(HOSTsong* song, XMPIN* plugin, const char* filename, DWORD rate, DWORD chans, int subsong) {
+	song->plugin = plugin;
+	song->file = hostOpenFile(filename);
+	song->subsongs = 0;
+	song->lengths.clear();
+	if (!song->file) {
+		return false;
+	}
+	if (!plugin->CheckFile(filename, (XMPFILE)song->file)) {
+		hostCloseFile(song->file);
+		return false;
+	}
+
+	// scanning for the playlist happens before playback, same as XMPlay
+	float* length = NULL;
+	char* tags = NULL;
+	song->file->pos = 0;
+	song->subsongs = plugin->GetFileInfo(filename, (XMPFILE)song->file, &length, &tags);
+	if (length) {
+		song->lengths.assign(length, length + song->subsongs);
+		hostFree(length);
+	}
+	if (tags) {
+		hostFree(tags);
+	}
+
+	song->file->pos = 0;
+	if (!plugin->Open(filename, (XMPFILE)song->file)) {
+		hostCloseFile(song->file);
+		return false;
+	}
+	song->format.rate = rate;
+	song->format.chan = chans;
+	song->format.res = 0;
+	plugin->SetFormat(&song->format);
+	if (subsong > 1) {
+		plugin->SetPosition(XMPIN_POS_SUBSONG | (subsong - 1));
+	}
+	return true;
+}
+void hostCloseSong(HOSTsong* song) {
+	song->plugin->Close();
+	hostCloseFile(song->file);
+	song->file = NULL;
+}
+
+float hostLength() {
+	return hostSetlength;
+}
+bool hostSeekable() {
+	return hostSetseekable != FALSE;
+}
+int hostTitleUpdates() {
+	return hostUpdates;
+}
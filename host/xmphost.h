@@ -0,0 +1,53 @@
+// XMPlay SIDevo headless host - stands in for XMPlay so the plugin can be driven without it
+#pragma once
+
+#include "xmpin.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// a file handed to the plugin as an XMPFILE, read whole into memory like XMPlay does for small files
+typedef struct
+{
+	std::string filename;
+	std::vector<uint8_t> data;
+	DWORD pos;
+} HOSTfile;
+
+// a song opened the way XMPlay opens it
+typedef struct
+{
+	XMPIN* plugin;
+	HOSTfile* file;
+	XMPFORMAT format;
+	DWORD subsongs;
+	std::vector<float> lengths;
+} HOSTsong;
+
+// registry values the plugin reads through xmpfreg, all live in the "SIDevo" section
+void hostSetting(const char* key, int value);
+void hostSetting(const char* key, const char* value);
+// parse key=value, numbers are stored as ints and anything else as a string
+bool hostSetting(const char* keyValue);
+
+// fetch the plugin interface the way XMPlay does when it loads the plugin
+XMPIN* hostLoad();
+// stop the plugin's workers, hostLoad has this run at exit
+void hostUnload();
+// the settings changed, the plugin rebuilds its engine when the next song is opened
+void hostReconfigure();
+
+// make data openable under filename without touching the disk
+void hostAddFile(const char* filename, const std::vector<uint8_t>& data);
+HOSTfile* hostOpenFile(const char* filename);
+void hostCloseFile(HOSTfile* file);
+
+// CheckFile, GetFileInfo, Open and SetFormat, then select the sub-song, returns false if the plugin refused it
+bool hostOpenSong(HOSTsong* song, XMPIN* plugin, const char* filename, DWORD rate, DWORD chans, int subsong);
+void hostCloseSong(HOSTsong* song);
+
+// what the plugin last reported through XMPFUNC_IN
+float hostLength();
+bool hostSeekable();
+int hostTitleUpdates();
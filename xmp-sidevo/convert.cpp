@@ -0,0 +1,122 @@
+// XMPlay SIDevo input plugin - 16-bit to float sample conversion
+#include "convert.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CONVERT_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CONVERT_AVX2_TARGET
+#else
+#define CONVERT_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+typedef void (*CONVERTkernel)(const short* in, float* out, int count, float scale);
+
+void convertSamplesScalar(const short* in, float* out, int count, float scale) {
+	for (int i = 0; i < count; i++) {
+		out[i] = (float)(in[i]) * scale;
+	}
+}
+
+#ifdef CONVERT_X86
+// 8 samples a step, each 16-bit sample is doubled up and shifted down to sign-extend it to 32 bits
+static void convertSamplesSSE2(const short* in, float* out, int count, float scale) {
+	const __m128 scaleVec = _mm_set1_ps(scale);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i samples = _mm_loadu_si128((const __m128i*)(in + i));
+		__m128i lowHalf = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+		__m128i highHalf = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lowHalf), scaleVec));
+		_mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(highHalf), scaleVec));
+	}
+	convertSamplesScalar(in + i, out + i, count - i, scale);
+}
+// 16 samples a step
+CONVERT_AVX2_TARGET static void convertSamplesAVX2(const short* in, float* out, int count, float scale) {
+	const __m256 scaleVec = _mm256_set1_ps(scale);
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m256i lowHalf = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in + i)));
+		__m256i highHalf = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in + i + 8)));
+		_mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(lowHalf), scaleVec));
+		_mm256_storeu_ps(out + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(highHalf), scaleVec));
+	}
+	convertSamplesScalar(in + i, out + i, count - i, scale);
+}
+
+// AVX2 needs the CPU to have it and the OS to save the YMM registers
+static bool cpuHasAVX2() {
+#ifdef _MSC_VER
+	int cpuInfo[4];
+	__cpuid(cpuInfo, 0);
+	if (cpuInfo[0] < 7) {
+		return false;
+	}
+	__cpuid(cpuInfo, 1);
+	if (!(cpuInfo[2] & (1 << 27)) || !(cpuInfo[2] & (1 << 28)) || (_xgetbv(0) & 6) != 6) {
+		return false;
+	}
+	__cpuidex(cpuInfo, 7, 0);
+	return (cpuInfo[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+static const char* kernelName = "scalar";
+static CONVERTkernel selectKernel() {
+#ifdef CONVERT_X86
+	if (cpuHasAVX2()) {
+		kernelName = "AVX2";
+		return convertSamplesAVX2;
+	}
+	kernelName = "SSE2";
+	return convertSamplesSSE2;
+#else
+	return convertSamplesScalar;
+#endif
+}
+static CONVERTkernel convertKernel() {
+	static const CONVERTkernel kernel = selectKernel();
+	return kernel;
+}
+
+// one kernel per fade direction, the loop only steps the level and never looks at the fade settings
+template <bool FADEIN>
+static int convertFaded(const short* in, float* out, int count, float scale, float step, float* level) {
+	float fade = *level;
+	int i = 0;
+	for (; i < count; i++) {
+		if (FADEIN) {
+			if (fade >= 1) {
+				break;
+			}
+			fade *= step;
+			if (fade > 1) fade = 1;
+		} else {
+			fade -= step;
+			if (fade < 0) fade = 0;
+		}
+		out[i] = (float)(in[i]) * (scale * fade);
+	}
+	*level = fade;
+	return i;
+}
+
+void convertSamples(const short* in, float* out, int count, float scale) {
+	convertKernel()(in, out, count, scale);
+}
+const char* convertPath() {
+	convertKernel();
+	return kernelName;
+}
+int convertFadein(const short* in, float* out, int count, float scale, float step, float* level) {
+	return convertFaded<true>(in, out, count, scale, step, level);
+}
+int convertFadeout(const short* in, float* out, int count, float scale, float step, float* level) {
+	return convertFaded<false>(in, out, count, scale, step, level);
+}
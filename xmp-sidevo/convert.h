@@ -0,0 +1,14 @@
+// XMPlay SIDevo input plugin - 16-bit to float sample conversion
+#pragma once
+
+// out[i] = in[i] * scale, with the widest vector path the CPU has, picked on the first call
+void convertSamples(const short* in, float* out, int count, float scale);
+// the plain loop, every vector path gives exactly the same floats
+void convertSamplesScalar(const short* in, float* out, int count, float scale);
+// name of the path convertSamples uses
+const char* convertPath();
+
+// the same conversion with a fade, the level is stepped before each sample (times step on a fade-in, minus step
+// on a fade-out) and held at 1 or 0, a fade-in stops at full level and returns how many samples it converted
+int convertFadein(const short* in, float* out, int count, float scale, float step, float* level);
+int convertFadeout(const short* in, float* out, int count, float scale, float step, float* level);
@@ -0,0 +1,517 @@
+// XMPlay SIDevo input plugin - frame-stepped PSID player
+#include "framestep.h"
+
+#include <algorithm>
+#include <string.h>
+
+using libsidplayfp::event_clock_t;
+
+#define FLAG_C 0x01
+#define FLAG_Z 0x02
+#define FLAG_I 0x04
+#define FLAG_D 0x08
+#define FLAG_B 0x10
+#define FLAG_U 0x20
+#define FLAG_V 0x40
+#define FLAG_N 0x80
+
+// how long init may run before the tune is left to the full machine
+#define FRAMESTEP_INITSEC 2.0
+
+static uint16_t headerWord(const uint8_t* data) {
+	return (data[0] << 8) | data[1];
+}
+// extra SID addresses the player accepts, $D420-$D7E0 and $DE00-$DFE0 in steps of $20
+static bool validSid(uint8_t addr) {
+	return !(addr & 0x01) && ((addr >= 0x42 && addr <= 0x7e) || (addr >= 0xe0 && addr <= 0xfe));
+}
+// one byte of state as a term of the state hash, which is their sum so a write only swaps two terms
+static unsigned long long stateTerm(uint32_t addr, uint8_t data) {
+	unsigned long long term = (((unsigned long long)addr << 8) | data) * 0x9e3779b97f4a7c15ULL;
+	term ^= term >> 31;
+	term *= 0xbf58476d1ce4e5b9ULL;
+	return term ^ (term >> 29);
+}
+// the banking the driver sets up before calling an address, ROMs stay in unless the code sits under them
+static uint8_t ioMap(uint16_t addr) {
+	if (addr < 0xa000) {
+		return 0x37;
+	} else if (addr < 0xd000) {
+		return 0x36;
+	} else if (addr >= 0xe000) {
+		return 0x35;
+	}
+	return 0x34;
+}
+
+bool SIDframestep::load(const std::vector<uint8_t>& tune, int subsong, double cpuFreq) {
+	if (tune.size() < 0x76 || memcmp(tune.data(), "PSID", 4)) {
+		return false;
+	}
+	const uint8_t* header = tune.data();
+	const int version = headerWord(header + 4);
+	const size_t dataOffset = headerWord(header + 6);
+	if (version < 1 || version > 4 || dataOffset < 0x76 || tune.size() < dataOffset + 2) {
+		return false;
+	}
+	uint16_t loadAddr = headerWord(header + 8);
+	m_init = headerWord(header + 0x0a);
+	m_play = headerWord(header + 0x0c);
+	const int songs = headerWord(header + 0x0e);
+	const uint32_t speed = ((uint32_t)headerWord(header + 0x12) << 16) | headerWord(header + 0x14);
+
+	size_t dataStart = dataOffset;
+	if (!loadAddr) {
+		loadAddr = tune[dataStart] | (tune[dataStart + 1] << 8);
+		dataStart += 2;
+	}
+	if (!m_init) {
+		m_init = loadAddr;
+	}
+	const size_t dataLength = tune.size() - dataStart;
+	// without a play address the tune installs its own interrupt, which needs the real CIAs and VIC
+	if (!m_play || subsong < 1 || subsong > songs || !dataLength || loadAddr + dataLength > 0x10000) {
+		return false;
+	}
+
+	m_chips = 1;
+	m_sidbase[0] = 0xd400;
+	if (version >= 2 && dataOffset >= 0x7c) {
+		if (headerWord(header + 0x76) & 0x01) {
+			return false;
+		}
+		if (version >= 3 && validSid(header[0x7a])) {
+			m_sidbase[m_chips++] = 0xd000 | (header[0x7a] << 4);
+			if (version >= 4 && validSid(header[0x7b]) && header[0x7b] != header[0x7a]) {
+				m_sidbase[m_chips++] = 0xd000 | (header[0x7b] << 4);
+			}
+		}
+	}
+
+	// power-on RAM pattern, then the tune on top
+	m_mem.assign(0x10000, 0x00);
+	for (size_t addr = 0x40; addr < m_mem.size(); addr += 0x80) {
+		std::fill(m_mem.begin() + addr, m_mem.begin() + addr + 0x40, 0xff);
+	}
+	std::copy(tune.begin() + dataStart, tune.end(), m_mem.begin() + loadAddr);
+
+	// the driver plays from the raster interrupt once a frame, or from the KERNAL's 60Hz CIA timer
+	const bool ntsc = cpuFreq > 1000000;
+	m_ciaspeed = (speed >> std::min(subsong - 1, 31)) & 1;
+	m_cialatch = ntsc ? 0x4295 : 0x4025;
+	period = m_ciaspeed ? m_cialatch + 1 : (ntsc ? 263 * 65 : 312 * 63);
+	m_cpufreq = cpuFreq;
+	m_song = subsong - 1;
+	memset(m_sidbus, 0, sizeof(m_sidbus));
+	m_state = 0;
+	for (uint32_t addr = 0; addr < m_mem.size(); addr++) {
+		m_state += stateTerm(addr, m_mem[addr]);
+	}
+	for (int chip = 0; chip < 3; chip++) {
+		m_state += stateTerm(0x10000 + chip, 0);
+	}
+	m_port = 0x37;
+	m_started = false;
+	m_inplay = false;
+	clock = 0;
+	firstplay = 0;
+	return true;
+}
+
+bool SIDframestep::frame(std::vector<SIDwrite>& writes) {
+	if (!m_started) {
+		m_started = true;
+		// init may decompress or build tables for a while, but it has to come back
+		if (!call(m_init, m_song, 0, (event_clock_t)(m_cpufreq * FRAMESTEP_INITSEC), writes)) {
+			return false;
+		}
+		if (m_ciaspeed) {
+			period = m_cialatch + 1;
+		}
+		firstplay = (m_cycles / period + 1) * period;
+		clock = firstplay;
+		return true;
+	}
+	// a play call that runs into the next one would be interrupted on the real machine
+	m_inplay = true;
+	const bool played = call(m_play, 0, clock, period, writes);
+	clock += period;
+	return played;
+}
+
+bool SIDframestep::sameState(const SIDframestep& other) const {
+	return m_mem == other.m_mem && !memcmp(m_sidbus, other.m_sidbus, sizeof(m_sidbus));
+}
+
+bool SIDframestep::call(uint16_t addr, uint8_t a, event_clock_t start, event_clock_t limit, std::vector<SIDwrite>& writes) {
+	m_writes = &writes;
+	m_start = start;
+	m_cycles = 0;
+	m_fault = false;
+	m_port = ioMap(addr);
+	m_pc = addr;
+	m_a = a;
+	m_x = 0;
+	m_y = 0;
+	m_p = FLAG_U | FLAG_I;
+	m_s = 0xff;
+	// returning from the call lands on address 0, the driver never jumps there
+	push(0xff);
+	push(0xff);
+	while (m_pc && !m_fault) {
+		if (m_cycles >= limit) {
+			return false;
+		}
+		step();
+	}
+	return !m_fault;
+}
+
+int SIDframestep::sidChip(uint16_t addr) const {
+	for (unsigned int chip = m_chips - 1; chip > 0; chip--) {
+		if ((addr & 0xffe0) == m_sidbase[chip]) {
+			return chip;
+		}
+	}
+	// the first SID is mirrored over the rest of $D400-$D7FF
+	return (addr >= 0xd400 && addr < 0xd800) ? 0 : -1;
+}
+
+uint8_t SIDframestep::read(uint16_t addr) {
+	if (addr == 0x0000) {
+		return 0x2f;
+	} else if (addr == 0x0001) {
+		return m_port;
+	}
+	// BASIC, KERNAL and character ROM are only in the full machine
+	if ((addr >= 0xa000 && addr < 0xc000 && (m_port & 3) == 3) || (addr >= 0xe000 && (m_port & 2))) {
+		m_fault = true;
+		return 0;
+	}
+	if (addr >= 0xd000 && addr < 0xe000 && (m_port & 3)) {
+		const int chip = (m_port & 4) ? sidChip(addr) : -1;
+		if (chip < 0) {
+			m_fault = true;
+			return 0;
+		}
+		// paddles, oscillator 3 and envelope 3 change on their own (noise randoms), only the full machine has them
+		const uint8_t reg = addr & 0x1f;
+		if (reg >= 0x19 && reg <= 0x1c) {
+			m_fault = true;
+			return 0;
+		}
+		return m_sidbus[chip];
+	}
+	return m_mem[addr];
+}
+
+void SIDframestep::write(uint16_t addr, uint8_t data) {
+	if (addr == 0x0000) {
+		m_fault = m_fault || data != 0x2f;
+		return;
+	} else if (addr == 0x0001) {
+		m_port = data;
+		return;
+	}
+	if (addr >= 0xd000 && addr < 0xe000 && (m_port & 3) && (m_port & 4)) {
+		const int chip = sidChip(addr);
+		if (chip >= 0) {
+			SIDwrite busWrite;
+			busWrite.clock = m_start + m_cycles;
+			busWrite.chip = chip;
+			busWrite.addr = addr & 0x1f;
+			busWrite.data = data;
+			m_writes->push_back(busWrite);
+			setBus(chip, data);
+		} else if ((addr & 0xff0e) == 0xdc04) {
+			// CIA 1 timer A sets the play rate of CIA timed tunes
+			m_cialatch = (addr & 1) ? ((m_cialatch & 0x00ff) | (data << 8)) : ((m_cialatch & 0xff00) | data);
+			m_fault = m_fault || m_inplay;
+		} else if (m_inplay) {
+			// changing the raster interrupt or a CIA from play moves the next call, only the full machine knows where
+			const uint8_t vicReg = addr & 0x3f;
+			m_fault = m_fault || (addr < 0xd400 && (vicReg == 0x11 || vicReg == 0x12 || vicReg == 0x1a)) || (addr >= 0xdc00 && addr < 0xde00);
+		}
+		return;
+	}
+	poke(addr, data);
+}
+void SIDframestep::poke(uint16_t addr, uint8_t data) {
+	m_state += stateTerm(addr, data) - stateTerm(addr, m_mem[addr]);
+	m_mem[addr] = data;
+}
+void SIDframestep::setBus(int chip, uint8_t data) {
+	m_state += stateTerm(0x10000 + chip, data) - stateTerm(0x10000 + chip, m_sidbus[chip]);
+	m_sidbus[chip] = data;
+}
+
+uint8_t SIDframestep::fetch() {
+	return read(m_pc++);
+}
+uint16_t SIDframestep::fetchWord() {
+	const uint8_t low = fetch();
+	return low | (fetch() << 8);
+}
+// indexed reads take a cycle more when they cross a page, writes always take it
+uint16_t SIDframestep::indexed(uint16_t base, uint8_t index, bool penalty) {
+	const uint16_t addr = base + index;
+	if (penalty && ((addr ^ base) & 0xff00)) {
+		m_cycles++;
+	}
+	return addr;
+}
+uint16_t SIDframestep::indirectX() {
+	const uint8_t zp = fetch() + m_x;
+	return read(zp) | (read((uint8_t)(zp + 1)) << 8);
+}
+uint16_t SIDframestep::indirectY(bool penalty) {
+	const uint8_t zp = fetch();
+	return indexed(read(zp) | (read((uint8_t)(zp + 1)) << 8), m_y, penalty);
+}
+void SIDframestep::push(uint8_t data) {
+	poke(0x100 | m_s--, data);
+}
+uint8_t SIDframestep::pull() {
+	return m_mem[0x100 | ++m_s];
+}
+void SIDframestep::setFlag(uint8_t flag, bool set) {
+	m_p = set ? (m_p | flag) : (m_p & ~flag);
+}
+void SIDframestep::setNZ(uint8_t value) {
+	setFlag(FLAG_Z, !value);
+	setFlag(FLAG_N, value & 0x80);
+}
+void SIDframestep::branch(bool taken) {
+	const int8_t offset = (int8_t)fetch();
+	if (taken) {
+		const uint16_t target = m_pc + offset;
+		m_cycles += ((target ^ m_pc) & 0xff00) ? 2 : 1;
+		m_pc = target;
+	}
+}
+void SIDframestep::compare(uint8_t reg, uint8_t value) {
+	setFlag(FLAG_C, reg >= value);
+	setNZ(reg - value);
+}
+// decimal mode follows the NMOS 6510, N, V and Z come out of the binary sum as they do on the chip
+void SIDframestep::adc(uint8_t value) {
+	const unsigned int carry = m_p & FLAG_C;
+	const unsigned int sum = m_a + value + carry;
+	if (m_p & FLAG_D) {
+		unsigned int low = (m_a & 0x0f) + (value & 0x0f) + carry;
+		unsigned int high = (m_a & 0xf0) + (value & 0xf0);
+		if (low > 0x09) low += 0x06;
+		if (low > 0x0f) high += 0x10;
+		setFlag(FLAG_Z, !(sum & 0xff));
+		setFlag(FLAG_N, high & 0x80);
+		setFlag(FLAG_V, ((high ^ m_a) & 0x80) && !((m_a ^ value) & 0x80));
+		if (high > 0x90) high += 0x60;
+		setFlag(FLAG_C, high > 0xff);
+		m_a = (high | (low & 0x0f)) & 0xff;
+	} else {
+		setFlag(FLAG_C, sum > 0xff);
+		setFlag(FLAG_V, ((sum ^ m_a) & 0x80) && !((m_a ^ value) & 0x80));
+		m_a = sum & 0xff;
+		setNZ(m_a);
+	}
+}
+void SIDframestep::sbc(uint8_t value) {
+	const unsigned int borrow = (m_p & FLAG_C) ? 0 : 1;
+	const unsigned int difference = m_a - value - borrow;
+	setFlag(FLAG_C, difference < 0x100);
+	setFlag(FLAG_V, ((difference ^ m_a) & 0x80) && ((m_a ^ value) & 0x80));
+	setNZ(difference & 0xff);
+	if (m_p & FLAG_D) {
+		unsigned int low = (m_a & 0x0f) - (value & 0x0f) - borrow;
+		unsigned int high = (m_a & 0xf0) - (value & 0xf0);
+		if (low & 0x10) {
+			low -= 0x06;
+			high -= 0x10;
+		}
+		if (high & 0x100) high -= 0x60;
+		m_a = (high | (low & 0x0f)) & 0xff;
+	} else {
+		m_a = difference & 0xff;
+	}
+}
+// 0 ASL, 1 ROL, 2 LSR, 3 ROR, the same order as in the opcodes
+uint8_t SIDframestep::shift(int op, uint8_t value) {
+	const uint8_t carry = m_p & FLAG_C;
+	uint8_t result;
+	if (op < 2) {
+		setFlag(FLAG_C, value & 0x80);
+		result = (value << 1) | (op ? carry : 0);
+	} else {
+		setFlag(FLAG_C, value & 0x01);
+		result = (value >> 1) | (op == 3 ? carry << 7 : 0);
+	}
+	setNZ(result);
+	return result;
+}
+// read-modify-write puts the old value back on the bus before the new one, so a SID register sees both
+void SIDframestep::modify(uint16_t addr, uint8_t op) {
+	const uint8_t value = read(addr);
+	write(addr, value);
+	uint8_t result;
+	if ((op & 0xc0) == 0xc0) {
+		result = (op & 0x20) ? value + 1 : value - 1;
+		setNZ(result);
+	} else {
+		result = shift(op >> 5, value);
+	}
+	write(addr, result);
+}
+
+void SIDframestep::step() {
+	const uint8_t op = fetch();
+	if (m_fault) {
+		return;
+	}
+
+	// ORA, AND, EOR, ADC, STA, LDA, CMP and SBC share their eight addressing modes
+	if ((op & 0x03) == 0x01) {
+		const int alu = op >> 5;
+		const bool store = alu == 4;
+		uint16_t addr = 0;
+		switch ((op >> 2) & 7) {
+		case 0: addr = indirectX(); m_cycles += 6; break;
+		case 1: addr = fetch(); m_cycles += 3; break;
+		case 2:
+			if (store) {
+				m_fault = true;
+				return;
+			}
+			addr = m_pc++;
+			m_cycles += 2;
+			break;
+		case 3: addr = fetchWord(); m_cycles += 4; break;
+		case 4: addr = indirectY(!store); m_cycles += store ? 6 : 5; break;
+		case 5: addr = (uint8_t)(fetch() + m_x); m_cycles += 4; break;
+		case 6: addr = indexed(fetchWord(), m_y, !store); m_cycles += store ? 5 : 4; break;
+		case 7: addr = indexed(fetchWord(), m_x, !store); m_cycles += store ? 5 : 4; break;
+		}
+		if (store) {
+			write(addr, m_a);
+			return;
+		}
+		const uint8_t value = read(addr);
+		switch (alu) {
+		case 0: m_a |= value; setNZ(m_a); break;
+		case 1: m_a &= value; setNZ(m_a); break;
+		case 2: m_a ^= value; setNZ(m_a); break;
+		case 3: adc(value); break;
+		case 5: m_a = value; setNZ(m_a); break;
+		case 6: compare(m_a, value); break;
+		case 7: sbc(value); break;
+		}
+		return;
+	}
+
+	uint8_t value;
+	uint16_t addr;
+	switch (op) {
+	// shifts, INC and DEC
+	case 0x0a: case 0x2a: case 0x4a: case 0x6a: m_cycles += 2; m_a = shift(op >> 5, m_a); break;
+	case 0x06: case 0x26: case 0x46: case 0x66: case 0xc6: case 0xe6: m_cycles += 5; modify(fetch(), op); break;
+	case 0x16: case 0x36: case 0x56: case 0x76: case 0xd6: case 0xf6: m_cycles += 6; modify((uint8_t)(fetch() + m_x), op); break;
+	case 0x0e: case 0x2e: case 0x4e: case 0x6e: case 0xce: case 0xee: m_cycles += 6; modify(fetchWord(), op); break;
+	case 0x1e: case 0x3e: case 0x5e: case 0x7e: case 0xde: case 0xfe: m_cycles += 7; modify(indexed(fetchWord(), m_x, false), op); break;
+
+	// X and Y loads, stores and compares
+	case 0xa2: m_cycles += 2; m_x = fetch(); setNZ(m_x); break;
+	case 0xa6: m_cycles += 3; m_x = read(fetch()); setNZ(m_x); break;
+	case 0xb6: m_cycles += 4; m_x = read((uint8_t)(fetch() + m_y)); setNZ(m_x); break;
+	case 0xae: m_cycles += 4; m_x = read(fetchWord()); setNZ(m_x); break;
+	case 0xbe: m_cycles += 4; m_x = read(indexed(fetchWord(), m_y, true)); setNZ(m_x); break;
+	case 0xa0: m_cycles += 2; m_y = fetch(); setNZ(m_y); break;
+	case 0xa4: m_cycles += 3; m_y = read(fetch()); setNZ(m_y); break;
+	case 0xb4: m_cycles += 4; m_y = read((uint8_t)(fetch() + m_x)); setNZ(m_y); break;
+	case 0xac: m_cycles += 4; m_y = read(fetchWord()); setNZ(m_y); break;
+	case 0xbc: m_cycles += 4; m_y = read(indexed(fetchWord(), m_x, true)); setNZ(m_y); break;
+	case 0x86: m_cycles += 3; write(fetch(), m_x); break;
+	case 0x96: m_cycles += 4; write((uint8_t)(fetch() + m_y), m_x); break;
+	case 0x8e: m_cycles += 4; write(fetchWord(), m_x); break;
+	case 0x84: m_cycles += 3; write(fetch(), m_y); break;
+	case 0x94: m_cycles += 4; write((uint8_t)(fetch() + m_x), m_y); break;
+	case 0x8c: m_cycles += 4; write(fetchWord(), m_y); break;
+	case 0xe0: m_cycles += 2; compare(m_x, fetch()); break;
+	case 0xe4: m_cycles += 3; compare(m_x, read(fetch())); break;
+	case 0xec: m_cycles += 4; compare(m_x, read(fetchWord())); break;
+	case 0xc0: m_cycles += 2; compare(m_y, fetch()); break;
+	case 0xc4: m_cycles += 3; compare(m_y, read(fetch())); break;
+	case 0xcc: m_cycles += 4; compare(m_y, read(fetchWord())); break;
+	case 0x24: case 0x2c:
+		m_cycles += op == 0x24 ? 3 : 4;
+		value = read(op == 0x24 ? fetch() : fetchWord());
+		setFlag(FLAG_Z, !(m_a & value));
+		setFlag(FLAG_N, value & 0x80);
+		setFlag(FLAG_V, value & 0x40);
+		break;
+
+	// branches
+	case 0x10: m_cycles += 2; branch(!(m_p & FLAG_N)); break;
+	case 0x30: m_cycles += 2; branch(m_p & FLAG_N); break;
+	case 0x50: m_cycles += 2; branch(!(m_p & FLAG_V)); break;
+	case 0x70: m_cycles += 2; branch(m_p & FLAG_V); break;
+	case 0x90: m_cycles += 2; branch(!(m_p & FLAG_C)); break;
+	case 0xb0: m_cycles += 2; branch(m_p & FLAG_C); break;
+	case 0xd0: m_cycles += 2; branch(!(m_p & FLAG_Z)); break;
+	case 0xf0: m_cycles += 2; branch(m_p & FLAG_Z); break;
+
+	// flags, transfers, increments
+	case 0x18: m_cycles += 2; setFlag(FLAG_C, false); break;
+	case 0x38: m_cycles += 2; setFlag(FLAG_C, true); break;
+	case 0x58: m_cycles += 2; setFlag(FLAG_I, false); break;
+	case 0x78: m_cycles += 2; setFlag(FLAG_I, true); break;
+	case 0xb8: m_cycles += 2; setFlag(FLAG_V, false); break;
+	case 0xd8: m_cycles += 2; setFlag(FLAG_D, false); break;
+	case 0xf8: m_cycles += 2; setFlag(FLAG_D, true); break;
+	case 0xaa: m_cycles += 2; m_x = m_a; setNZ(m_x); break;
+	case 0xa8: m_cycles += 2; m_y = m_a; setNZ(m_y); break;
+	case 0xba: m_cycles += 2; m_x = m_s; setNZ(m_x); break;
+	case 0x8a: m_cycles += 2; m_a = m_x; setNZ(m_a); break;
+	case 0x9a: m_cycles += 2; m_s = m_x; break;
+	case 0x98: m_cycles += 2; m_a = m_y; setNZ(m_a); break;
+	case 0xe8: m_cycles += 2; setNZ(++m_x); break;
+	case 0xc8: m_cycles += 2; setNZ(++m_y); break;
+	case 0xca: m_cycles += 2; setNZ(--m_x); break;
+	case 0x88: m_cycles += 2; setNZ(--m_y); break;
+	case 0xea: m_cycles += 2; break;
+
+	// stack and jumps
+	case 0x48: m_cycles += 3; push(m_a); break;
+	case 0x08: m_cycles += 3; push(m_p | FLAG_B | FLAG_U); break;
+	case 0x68: m_cycles += 4; m_a = pull(); setNZ(m_a); break;
+	case 0x28: m_cycles += 4; m_p = (pull() & ~FLAG_B) | FLAG_U; break;
+	case 0x4c: m_cycles += 3; m_pc = fetchWord(); break;
+	case 0x6c:
+		// the pointer's high byte comes from the same page, as on the chip
+		m_cycles += 5;
+		addr = fetchWord();
+		m_pc = read(addr) | (read((addr & 0xff00) | ((addr + 1) & 0x00ff)) << 8);
+		break;
+	case 0x20:
+		m_cycles += 6;
+		addr = fetchWord();
+		push((m_pc - 1) >> 8);
+		push((m_pc - 1) & 0xff);
+		m_pc = addr;
+		break;
+	case 0x60:
+		m_cycles += 6;
+		addr = pull();
+		m_pc = (addr | (pull() << 8)) + 1;
+		break;
+	case 0x40:
+		m_cycles += 6;
+		m_p = (pull() & ~FLAG_B) | FLAG_U;
+		addr = pull();
+		m_pc = addr | (pull() << 8);
+		break;
+
+	// BRK and the undocumented opcodes are left to the full machine
+	default:
+		m_fault = true;
+		break;
+	}
+}
@@ -0,0 +1,79 @@
+// XMPlay SIDevo input plugin - frame-stepped PSID player
+#pragma once
+
+#include "recorder.h"
+
+#include <stdint.h>
+#include <vector>
+
+// plays a PSID the way its driver calls it, init once and then play once a frame, on a flat 64K memory with a
+// plain 6510 and no VIC, CIA or bus timing, which is far cheaper than the full machine for as long as the tune
+// only talks to its SIDs
+class SIDframestep
+{
+public:
+	// where the next play call starts and how far apart the calls are, in CPU cycles
+	libsidplayfp::event_clock_t clock;
+	libsidplayfp::event_clock_t period;
+	// where the first play call started, everything before it came from init
+	libsidplayfp::event_clock_t firstplay;
+
+	// false for anything the driver does more with than calling it, RSIDs, MUS data and tunes without a play address
+	bool load(const std::vector<uint8_t>& tune, int subsong, double cpuFreq);
+	// one call, init on the first frame and play after that, its SID writes are added to writes; false once the tune
+	// does something only the full machine can answer, e.g. reads a VIC or CIA register or runs an undocumented opcode
+	bool frame(std::vector<SIDwrite>& writes);
+
+	// hash of all the next call can see, the RAM and what is left on the SID buses; with the same state the
+	// calls from there on repeat exactly, but only sameState can tell two states apart for sure
+	unsigned long long state() const { return m_state; }
+	bool sameState(const SIDframestep& other) const;
+
+private:
+	std::vector<uint8_t> m_mem;
+	uint16_t m_init;
+	uint16_t m_play;
+	uint8_t m_song;
+	uint16_t m_sidbase[3];
+	unsigned int m_chips;
+	uint8_t m_sidbus[3];
+	unsigned long long m_state;
+	bool m_ciaspeed;
+	uint16_t m_cialatch;
+	double m_cpufreq;
+	bool m_started;
+	bool m_inplay;
+
+	// CPU state, each call starts from a fresh stack
+	uint16_t m_pc;
+	uint8_t m_a, m_x, m_y, m_s, m_p;
+	uint8_t m_port;
+	libsidplayfp::event_clock_t m_cycles;
+	libsidplayfp::event_clock_t m_start;
+	std::vector<SIDwrite>* m_writes;
+	bool m_fault;
+
+	bool call(uint16_t addr, uint8_t a, libsidplayfp::event_clock_t start, libsidplayfp::event_clock_t limit, std::vector<SIDwrite>& writes);
+	void step();
+	int sidChip(uint16_t addr) const;
+	uint8_t read(uint16_t addr);
+	void write(uint16_t addr, uint8_t data);
+	void poke(uint16_t addr, uint8_t data);
+	void setBus(int chip, uint8_t data);
+
+	uint8_t fetch();
+	uint16_t fetchWord();
+	uint16_t indexed(uint16_t base, uint8_t index, bool penalty);
+	uint16_t indirectX();
+	uint16_t indirectY(bool penalty);
+	void push(uint8_t data);
+	uint8_t pull();
+	void setFlag(uint8_t flag, bool set);
+	void setNZ(uint8_t value);
+	void branch(bool taken);
+	void compare(uint8_t reg, uint8_t value);
+	void adc(uint8_t value);
+	void sbc(uint8_t value);
+	uint8_t shift(int op, uint8_t value);
+	void modify(uint16_t addr, uint8_t op);
+};
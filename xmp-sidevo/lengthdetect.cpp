@@ -0,0 +1,396 @@
+// XMPlay SIDevo input plugin - song length detection
+#include "lengthdetect.h"
+#include "framestep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+using libsidplayfp::event_clock_t;
+
+// seconds of machine emulation a frame-stepped PSID has to match before it takes over
+#define FRAMESTEP_VERIFYSEC 5
+// play calls the frame stepper runs between two looks at the writes
+#define FRAMESTEP_FRAMES 25
+// memory the loop search may hold on to, digi streams write millions of times so older history is dropped past it
+#define DETECT_MAXBYTES (64 << 20)
+
+// release times of the SID envelope in ms, from the datasheet
+static const double releaseMs[16] = { 6, 24, 48, 72, 114, 168, 204, 240, 300, 750, 1500, 2400, 3000, 9000, 15000, 24000 };
+
+// register state needed to tell whether the chips can still be heard
+typedef struct
+{
+	uint8_t regs[3][0x20];
+	event_clock_t gateoff[3][3];
+} SIDquiet;
+
+// returns the clock the chips went quiet at, or -1 while something can still be heard
+static event_clock_t quietSince(const SIDquiet& quietState, unsigned int chips, double cpuFreq) {
+	event_clock_t quietClock = 0;
+	for (unsigned int chip = 0; chip < chips; chip++) {
+		if ((quietState.regs[chip][0x18] & 0x0f) == 0) {
+			continue;
+		}
+		for (int v = 0; v < 3; v++) {
+			if (quietState.regs[chip][v * 7 + 4] & 0x01) {
+				return -1;
+			}
+			event_clock_t releaseClock = quietState.gateoff[chip][v] + (event_clock_t)(releaseMs[quietState.regs[chip][v * 7 + 6] & 0x0f] * cpuFreq / 1000);
+			quietClock = std::max(quietClock, releaseClock);
+		}
+	}
+	return quietClock;
+}
+
+// the analysis of one sub-song, fed the writes of one play call after another
+class SIDdetector
+{
+private:
+	const unsigned int chips;
+	SIDquiet quietState;
+	// the writes from writeBase on, window positions count from the first write of the sub-song
+	std::vector<uint32_t> writeTokens;
+	std::vector<event_clock_t> writeClocks;
+	size_t writeBase;
+	std::unordered_map<unsigned long long, size_t> windowSeen;
+	unsigned long long windowHash;
+	unsigned long long windowPower;
+	size_t windowSize;
+	size_t windowNext;
+	bool heardSound;
+	event_clock_t quietClock;
+	event_clock_t lastClock;
+
+public:
+	SIDdetector(unsigned int detectChips) :
+		chips(detectChips),
+		quietState(),
+		writeBase(0),
+		windowHash(0),
+		windowPower(1),
+		windowSize(0),
+		windowNext(0),
+		heardSound(false),
+		quietClock(0),
+		lastClock(0)
+	{
+	}
+
+	// what the history costs, a seen window is a hash node of a key, a position and the bucket links
+	size_t historyBytes() const {
+		return writeTokens.size() * (sizeof(uint32_t) + sizeof(event_clock_t)) + windowSeen.size() * (sizeof(unsigned long long) + sizeof(size_t) + 2 * sizeof(void*));
+	}
+
+	// drops the older half of the history, a loop can then only be found against a first pass that is still held;
+	// false when even the current window doesn't fit
+	bool trimHistory() {
+		const size_t writeEnd = writeBase + writeTokens.size();
+		const size_t keepFrom = writeBase + writeTokens.size() / 2;
+		if (!windowSize || writeEnd - keepFrom < 2 * windowSize) {
+			return false;
+		}
+		for (std::unordered_map<unsigned long long, size_t>::iterator windowEntry = windowSeen.begin(); windowEntry != windowSeen.end();) {
+			if (windowEntry->second + 1 - windowSize < keepFrom) {
+				windowEntry = windowSeen.erase(windowEntry);
+			} else {
+				++windowEntry;
+			}
+		}
+		writeTokens.erase(writeTokens.begin(), writeTokens.begin() + (keepFrom - writeBase));
+		writeClocks.erase(writeClocks.begin(), writeClocks.begin() + (keepFrom - writeBase));
+		writeBase = keepFrom;
+		return true;
+	}
+
+	// returns the length in seconds, 0 if it can't be told, or -1 while more writes are needed; no loop is looked for
+	// unless loopable, i.e. the tune never read back something the recorder made up
+	int feed(const std::vector<SIDwrite>& writes, event_clock_t nowClock, double cpuFreq, bool loopable) {
+		const unsigned long long hashBase = 1099511628211ULL;
+		int digiWrites = 0;
+		for (const SIDwrite& busWrite : writes) {
+			if (busWrite.chip >= chips) {
+				continue;
+			}
+			uint8_t* chipRegs = quietState.regs[busWrite.chip];
+			if (busWrite.addr == 0x18) {
+				digiWrites++;
+			} else if (busWrite.addr < 0x15 && busWrite.addr % 7 == 4 && (chipRegs[busWrite.addr] & 0x01) && !(busWrite.data & 0x01)) {
+				quietState.gateoff[busWrite.chip][busWrite.addr / 7] = busWrite.clock;
+			}
+			chipRegs[busWrite.addr & 0x1f] = busWrite.data;
+
+			// going quiet counts from this write at the earliest, e.g. when the volume is zeroed
+			event_clock_t writeQuiet = quietSince(quietState, chips, cpuFreq);
+			if (writeQuiet < 0) {
+				heardSound = true;
+				quietClock = -1;
+			} else if (quietClock < 0) {
+				quietClock = std::max(writeQuiet, busWrite.clock);
+			} else {
+				quietClock = std::max(quietClock, writeQuiet);
+			}
+
+			writeTokens.push_back((busWrite.chip << 16) | (busWrite.addr << 8) | busWrite.data);
+			writeClocks.push_back(busWrite.clock);
+		}
+
+		// volume register written at sample rate means digis, those are never silent
+		if (digiWrites > (nowClock - lastClock) * 1000 / cpuFreq) {
+			heardSound = true;
+			quietClock = -1;
+		}
+		lastClock = nowClock;
+
+
+		// silence, the chips have been quiet for a few seconds after making a sound
+		if (heardSound && quietClock >= 0 && quietClock < nowClock && nowClock - quietClock > (event_clock_t)(4 * cpuFreq)) {
+			return (int)std::ceil(quietClock / cpuFreq);
+		}
+		// frozen, nothing written for a long time so whatever is sounding will never change
+		if (heardSound && !writeClocks.empty() && nowClock - writeClocks.back() > (event_clock_t)(30 * cpuFreq)) {
+			return (int)std::ceil(writeClocks.back() / cpuFreq) + 1;
+		}
+
+		// writes that depend on made-up reads may repeat where the real chips wouldn't, keep only the last for the frozen check
+		if (!loopable) {
+			const size_t dropCount = writeTokens.empty() ? 0 : writeTokens.size() - 1;
+			writeTokens.erase(writeTokens.begin(), writeTokens.begin() + dropCount);
+			writeClocks.erase(writeClocks.begin(), writeClocks.begin() + dropCount);
+			writeBase += dropCount;
+			windowSeen.clear();
+			return -1;
+		}
+
+		// size the loop window from the write rate, long enough to span 20 seconds of music
+		if (!windowSize) {
+			if (nowClock < (event_clock_t)(30 * cpuFreq)) {
+				return -1;
+			}
+			event_clock_t rateClock = (event_clock_t)(10 * cpuFreq);
+			size_t rateStart = std::lower_bound(writeClocks.begin(), writeClocks.end(), rateClock) - writeClocks.begin();
+			windowSize = std::max<size_t>(writeTokens.size() - rateStart, 1024);
+			for (size_t i = 0; i < windowSize; i++) {
+				windowPower *= hashBase;
+			}
+		}
+
+		// rolling hash over the last windowSize writes, a repeated window means the song has looped
+		for (; windowNext < writeBase + writeTokens.size(); windowNext++) {
+			windowHash = windowHash * hashBase + writeTokens[windowNext - writeBase] + 1;
+			if (windowNext >= windowSize) {
+				windowHash -= (writeTokens[windowNext - windowSize - writeBase] + 1) * windowPower;
+			} else if (windowNext + 1 < windowSize) {
+				continue;
+			}
+
+			std::unordered_map<unsigned long long, size_t>::iterator windowMatch = windowSeen.find(windowHash);
+			const size_t firstStart = windowMatch == windowSeen.end() ? 0 : windowMatch->second + 1 - windowSize - writeBase;
+			const size_t secondStart = windowNext + 1 - windowSize - writeBase;
+			if (windowMatch == windowSeen.end()) {
+				windowSeen.emplace(windowHash, windowNext);
+			} else if (std::equal(writeTokens.begin() + firstStart, writeTokens.begin() + (firstStart + windowSize), writeTokens.begin() + secondStart)) {
+				// the second pass starts where the repeated window begins
+				const event_clock_t secondClock = writeClocks[secondStart];
+				return (int)std::ceil(secondClock / cpuFreq);
+			}
+		}
+
+		// digi streams can write millions of times, forget the oldest passes rather than run out of memory
+		if (historyBytes() > DETECT_MAXBYTES && !trimHistory()) {
+			return 0;
+		}
+		return -1;
+	}
+};
+
+// looks for the frame stepper to start a play call from a state it has been in before, every call from there on
+// writes exactly what the calls after the first time did, so the tune loops for good
+class SIDstateloop
+{
+private:
+	const std::vector<uint8_t>& data;
+	const int subsong;
+	const double cpuFreq;
+	std::unordered_map<unsigned long long, event_clock_t> stateSeen;
+
+public:
+	// where the play calls that start from the same state begin, both zero until one is found
+	event_clock_t firstClock;
+	event_clock_t secondClock;
+
+	SIDstateloop(const std::vector<uint8_t>& loopData, int loopSubsong, double loopFreq) :
+		data(loopData),
+		subsong(loopSubsong),
+		cpuFreq(loopFreq),
+		firstClock(0),
+		secondClock(0)
+	{
+	}
+
+	// called between two play calls, true once the loop is found
+	bool check(const SIDframestep& framestep) {
+		if (secondClock) {
+			return true;
+		}
+		std::pair<std::unordered_map<unsigned long long, event_clock_t>::iterator, bool> stateEntry = stateSeen.emplace(framestep.state(), framestep.clock);
+		if (stateEntry.second) {
+			return false;
+		}
+
+		// the hash only names a candidate, step a second player up to it and compare the whole state
+		SIDframestep replay;
+		std::vector<SIDwrite> replayWrites;
+		if (!replay.load(data, subsong, cpuFreq)) {
+			return false;
+		}
+		do {
+			replayWrites.clear();
+			if (!replay.frame(replayWrites)) {
+				return false;
+			}
+		} while (replay.clock < stateEntry.first->second);
+		if (!replay.sameState(framestep)) {
+			stateEntry.first->second = framestep.clock;
+			return false;
+		}
+		firstClock = stateEntry.first->second;
+		secondClock = framestep.clock;
+		return true;
+	}
+};
+
+// the frame stepper takes over when it wrote exactly what the machine did in its first seconds, at the same rate,
+// returns the length like the detector or -1 when the tune needs the machine after all
+static int detectFramestep(const std::vector<uint8_t>& detectData, int detectSubsong, const std::vector<SIDwrite>& machineWrites, event_clock_t machineClock, double cpuFreq, unsigned int chips, int maxSeconds, SIDloop* detectLoop, const std::atomic<bool>* detectStop) {
+	SIDframestep framestep;
+	if (machineWrites.empty() || !framestep.load(detectData, detectSubsong, cpuFreq)) {
+		return -1;
+	}
+	SIDstateloop stateLoop(detectData, detectSubsong, cpuFreq);
+	std::vector<SIDwrite> stepWrites;
+	while (framestep.clock < machineClock + 2 * framestep.period) {
+		if (!framestep.frame(stepWrites)) {
+			return -1;
+		}
+		if (detectLoop) {
+			stateLoop.check(framestep);
+		}
+	}
+	if (stepWrites.size() < machineWrites.size()) {
+		return -1;
+	}
+
+	// the machine calls play from its interrupt a little later, but always the same distance behind
+	bool anchored = false;
+	event_clock_t stepOffset = 0;
+	event_clock_t minOffset = 0;
+	event_clock_t maxOffset = 0;
+	for (size_t i = 0; i < machineWrites.size(); i++) {
+		const SIDwrite& machineWrite = machineWrites[i];
+		const SIDwrite& stepWrite = stepWrites[i];
+		if (machineWrite.chip != stepWrite.chip || machineWrite.addr != stepWrite.addr || machineWrite.data != stepWrite.data) {
+			return -1;
+		}
+		if (stepWrite.clock < framestep.firstplay) {
+			continue;
+		}
+		const event_clock_t writeOffset = machineWrite.clock - stepWrite.clock;
+		if (!anchored) {
+			anchored = true;
+			stepOffset = minOffset = maxOffset = writeOffset;
+		}
+		minOffset = std::min(minOffset, writeOffset);
+		maxOffset = std::max(maxOffset, writeOffset);
+	}
+	if (!anchored || maxOffset - minOffset > framestep.period / 2) {
+		return -1;
+	}
+
+	// with the length known the stepper only carries on while it still looks for the loop
+	SIDdetector stepDetect(chips);
+	int length = -1;
+	for (;;) {
+		for (SIDwrite& stepWrite : stepWrites) {
+			stepWrite.clock += stepOffset;
+		}
+		const event_clock_t nowClock = framestep.clock + stepOffset;
+		if (length < 0) {
+			length = stepDetect.feed(stepWrites, nowClock, cpuFreq, true);
+		}
+		if (length >= 0 && (!detectLoop || stateLoop.secondClock)) {
+			break;
+		}
+		if (nowClock >= (event_clock_t)(maxSeconds * cpuFreq) || (detectStop && *detectStop)) {
+			length = std::max(length, 0);
+			break;
+		}
+		stepWrites.clear();
+		bool stepped = true;
+		for (int i = 0; i < FRAMESTEP_FRAMES && stepped; i++) {
+			stepped = framestep.frame(stepWrites);
+			if (stepped && detectLoop) {
+				stateLoop.check(framestep);
+			}
+		}
+		if (!stepped) {
+			break;
+		}
+	}
+
+	if (detectLoop && stateLoop.secondClock) {
+		detectLoop->start = (stateLoop.firstClock + stepOffset) / cpuFreq;
+		detectLoop->period = (stateLoop.secondClock - stateLoop.firstClock) / cpuFreq;
+	}
+	return length;
+}
+
+int detectSonglength(sidplayfp* detectEngine, RecorderBuilder* detectBuilder, SidTune* detectSong, int detectSubsong, int maxSeconds, SIDloop* detectLoop, const std::vector<uint8_t>* detectData, const std::atomic<bool>* detectStop) {
+	if (detectLoop) {
+		detectLoop->start = 0;
+		detectLoop->period = 0;
+	}
+	detectSong->selectSong(detectSubsong);
+	if (!detectEngine->load(detectSong)) {
+		return 0;
+	}
+	detectBuilder->writes.clear();
+	detectBuilder->readback = false;
+
+	const unsigned int chips = std::min(3u, detectSong->getInfo()->sidChips());
+	SIDdetector machineDetect(chips);
+	// the first seconds always come from the machine, they decide whether a PSID can be frame-stepped instead
+	bool verifying = detectData != nullptr;
+	std::vector<SIDwrite> verifyWrites;
+
+	while (detectEngine->time() < (unsigned int)maxSeconds && !(detectStop && *detectStop)) {
+		// no output buffer, the recorder only collects the register writes
+		detectEngine->play(nullptr, 0);
+		if (!detectEngine->isPlaying()) {
+			break;
+		}
+
+		const double cpuFreq = detectBuilder->cpuFreq > 0 ? detectBuilder->cpuFreq : 985248.0;
+		const event_clock_t nowClock = (event_clock_t)(detectEngine->timeMs() * cpuFreq / 1000);
+		if (verifying) {
+			verifyWrites.insert(verifyWrites.end(), detectBuilder->writes.begin(), detectBuilder->writes.end());
+		}
+		const int length = machineDetect.feed(detectBuilder->writes, nowClock, cpuFreq, !detectBuilder->readback);
+		detectBuilder->writes.clear();
+		if (length >= 0) {
+			return length;
+		}
+
+		// a tune that fails the check or stops stepping later carries on in the machine where it left off
+		if (verifying && nowClock >= (event_clock_t)(FRAMESTEP_VERIFYSEC * cpuFreq)) {
+			verifying = false;
+			const int stepLength = detectFramestep(*detectData, detectSubsong, verifyWrites, nowClock, cpuFreq, chips, maxSeconds, detectLoop, detectStop);
+			if (stepLength >= 0) {
+				return stepLength;
+			}
+			std::vector<SIDwrite>().swap(verifyWrites);
+		}
+	}
+
+	return 0;
+}
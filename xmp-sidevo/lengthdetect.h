@@ -0,0 +1,23 @@
+// XMPlay SIDevo input plugin - song length detection
+#pragma once
+
+#include "recorder.h"
+
+#include <sidplayfp/sidplayfp.h>
+#include <sidplayfp/SidTune.h>
+
+#include <atomic>
+#include <vector>
+
+// where a sub-song starts repeating itself exactly and how long one pass is, in seconds, both zero unless the frame
+// stepper saw a play call start from the same RAM and SID bus state twice
+typedef struct
+{
+	double start;
+	double period;
+} SIDloop;
+
+// detect the length of one sub-song from its register-write stream, returns seconds or 0 if unknown; given the
+// file data a PSID that only talks to its SIDs is frame-stepped after the first seconds instead of emulated, setting
+// detectStop gives up early with 0
+int detectSonglength(sidplayfp* detectEngine, RecorderBuilder* detectBuilder, SidTune* detectSong, int detectSubsong, int maxSeconds, SIDloop* detectLoop = nullptr, const std::vector<uint8_t>* detectData = nullptr, const std::atomic<bool>* detectStop = nullptr);
@@ -0,0 +1,96 @@
+// XMPlay SIDevo input plugin - register-write recording SID builder
+#include "recorder.h"
+
+#include <new>
+
+namespace libsidplayfp
+{
+
+Recorder::Recorder(RecorderBuilder* builder) :
+	sidemu(builder),
+	m_recorder(builder),
+	m_chip(0),
+	m_bus(0)
+{
+	// the mixer still expects a buffer, it just never gets any samples
+	m_buffer = new short[OUTPUTBUFFERSIZE];
+}
+Recorder::~Recorder()
+{
+	delete[] m_buffer;
+}
+bool Recorder::lock(EventScheduler* scheduler)
+{
+	if (!sidemu::lock(scheduler)) {
+		return false;
+	}
+	m_chip = m_recorder->locked++;
+	return true;
+}
+void Recorder::unlock()
+{
+	if (isLocked) {
+		m_recorder->locked--;
+	}
+	sidemu::unlock();
+}
+uint8_t Recorder::read(uint_least8_t addr)
+{
+	// there is no paddle, oscillator or envelope to read back, the detector is told its writes can't be trusted to repeat
+	if (addr >= 0x19 && addr <= 0x1c) {
+		m_recorder->readback = true;
+		return 0;
+	}
+	return m_bus;
+}
+void Recorder::write(uint_least8_t addr, uint8_t data)
+{
+	SIDwrite busWrite;
+	busWrite.clock = eventScheduler->getTime(EVENT_CLOCK_PHI1);
+	busWrite.chip = m_chip;
+	busWrite.addr = addr;
+	busWrite.data = data;
+	m_recorder->writes.push_back(busWrite);
+	m_bus = data;
+}
+void Recorder::reset(uint8_t)
+{
+	m_accessClk = 0;
+	m_bus = 0;
+}
+void Recorder::clock()
+{
+	m_accessClk = eventScheduler->getTime(EVENT_CLOCK_PHI1);
+}
+void Recorder::sampling(float systemclock, float, SidConfig::sampling_method_t, bool)
+{
+	m_recorder->cpuFreq = systemclock;
+}
+
+}
+
+RecorderBuilder::~RecorderBuilder()
+{
+	// remove all SID emulations
+	remove();
+}
+unsigned int RecorderBuilder::create(unsigned int sids)
+{
+	m_status = true;
+
+	unsigned int count;
+	for (count = 0; count < sids; count++) {
+		try {
+			sidobjs.insert(new libsidplayfp::Recorder(this));
+		} catch (std::bad_alloc const&) {
+			m_errorBuffer.assign(name()).append(" ERROR: Unable to create Recorder object");
+			m_status = false;
+			break;
+		}
+	}
+	return count;
+}
+const char* RecorderBuilder::credits() const
+{
+	return "SIDevo register-write recorder";
+}
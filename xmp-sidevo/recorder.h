@@ -0,0 +1,71 @@
+// XMPlay SIDevo input plugin - register-write recording SID builder
+#pragma once
+
+#include <sidplayfp/sidbuilder.h>
+#include <sidemu.h>
+#include <EventScheduler.h>
+
+#include <stdint.h>
+#include <vector>
+
+// one SID register write as seen on the C64 bus
+typedef struct
+{
+	libsidplayfp::event_clock_t clock;
+	uint8_t chip;
+	uint8_t addr;
+	uint8_t data;
+} SIDwrite;
+
+class RecorderBuilder;
+
+namespace libsidplayfp
+{
+
+// SID emulation that generates no audio at all, it only logs what the CPU writes
+class Recorder final : public sidemu
+{
+private:
+	RecorderBuilder* m_recorder;
+	uint8_t m_chip;
+	uint8_t m_bus;
+
+public:
+	Recorder(RecorderBuilder* builder);
+	~Recorder() override;
+
+	// the engine locks its chips in slot order, so the chip index is taken here rather than at creation
+	bool lock(EventScheduler* scheduler) override;
+	void unlock() override;
+
+	uint8_t read(uint_least8_t addr) override;
+	void write(uint_least8_t addr, uint8_t data) override;
+	void reset(uint8_t volume) override;
+	void clock() override;
+	void sampling(float systemclock, float freq, SidConfig::sampling_method_t method, bool fast) override;
+	void voice(unsigned int, bool) override {}
+	void model(SidConfig::sid_model_t, bool) override {}
+};
+
+}
+
+class RecorderBuilder : public sidbuilder
+{
+public:
+	// every write of every chip in bus order, the owner drains it between play calls
+	std::vector<SIDwrite> writes;
+	double cpuFreq;
+	// chips the engine holds, the next one it locks is the slot after them
+	unsigned int locked;
+	// the tune read a register only a real chip can answer, set until the owner clears it
+	bool readback;
+
+public:
+	RecorderBuilder(const char* const name) : sidbuilder(name), cpuFreq(0), locked(0), readback(false) {}
+	~RecorderBuilder() override;
+
+	unsigned int availDevices() const override { return 0; }
+	unsigned int create(unsigned int sids) override;
+	const char* credits() const override;
+	void filter(bool) override {}
+};
@@ -0,0 +1,197 @@
+// XMPlay SIDevo input plugin - Chrome trace-event timeline of plugin calls
+#include "trace.h"
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#define TRACE_CHUNK 4096
+// events kept over all threads, running or finished, about 32MB
+#define TRACE_MAXEVENTS (1 << 20)
+
+typedef struct
+{
+	const char* name;
+	const char* category;
+	long long start;
+	long long duration;
+} TRACEevent;
+
+// events of one running thread, only that thread writes them and count publishes them to the writer
+struct TRACEbuffer
+{
+	int tid;
+	std::atomic<const char*> threadname;
+	std::atomic<TRACEevent*> chunks[TRACE_MAXEVENTS / TRACE_CHUNK];
+	std::atomic<size_t> count;
+
+	~TRACEbuffer() {
+		for (std::atomic<TRACEevent*>& chunk : chunks) {
+			delete[] chunk.load();
+		}
+	}
+};
+
+// events of a thread that has finished, packed when it exits
+typedef struct
+{
+	int tid;
+	const char* threadname;
+	std::vector<TRACEevent> events;
+} TRACEfinished;
+
+// everything the trace holds, never freed because workers still exit while static objects are destroyed
+struct TRACEstate
+{
+	// taken once per thread to add its buffer, when it exits, and while writing the file
+	std::mutex lock;
+	std::vector<std::unique_ptr<TRACEbuffer>> buffers;
+	std::vector<TRACEfinished> finished;
+	int threads;
+	std::atomic<size_t> events;
+};
+static TRACEstate& traceState() {
+	static TRACEstate* state = new TRACEstate();
+	return *state;
+}
+
+// hands the thread's events to the trace when it exits and frees its buffer
+struct TRACEowner
+{
+	TRACEbuffer* buffer;
+
+	~TRACEowner() {
+		if (!buffer) {
+			return;
+		}
+		TRACEstate& state = traceState();
+		std::lock_guard<std::mutex> lock(state.lock);
+		TRACEfinished finished;
+		finished.tid = buffer->tid;
+		finished.threadname = buffer->threadname.load();
+		const size_t count = buffer->count.load(std::memory_order_acquire);
+		finished.events.reserve(count);
+		for (size_t index = 0; index < count; index++) {
+			finished.events.push_back(buffer->chunks[index / TRACE_CHUNK].load(std::memory_order_relaxed)[index % TRACE_CHUNK]);
+		}
+		state.finished.push_back(std::move(finished));
+		for (std::vector<std::unique_ptr<TRACEbuffer>>::iterator owned = state.buffers.begin(); owned != state.buffers.end(); ++owned) {
+			if (owned->get() == buffer) {
+				state.buffers.erase(owned);
+				break;
+			}
+		}
+	}
+};
+
+static std::atomic<bool> traceOn(false);
+static std::chrono::steady_clock::time_point traceEpoch;
+static bool traceStarted = false;
+static thread_local TRACEowner traceThread = { nullptr };
+
+static long long traceNow() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceEpoch).count();
+}
+static TRACEbuffer* threadBuffer() {
+	if (!traceThread.buffer) {
+		TRACEstate& state = traceState();
+		std::lock_guard<std::mutex> lock(state.lock);
+		state.buffers.emplace_back(new TRACEbuffer());
+		traceThread.buffer = state.buffers.back().get();
+		traceThread.buffer->tid = ++state.threads;
+	}
+	return traceThread.buffer;
+}
+
+void traceEnable(bool enable) {
+	if (enable) {
+		std::lock_guard<std::mutex> lock(traceState().lock);
+		if (!traceStarted) {
+			traceEpoch = std::chrono::steady_clock::now();
+			traceStarted = true;
+		}
+	}
+	traceOn.store(enable, std::memory_order_release);
+}
+bool traceActive() {
+	return traceOn.load(std::memory_order_acquire);
+}
+void traceThreadname(const char* name) {
+	if (traceActive()) {
+		threadBuffer()->threadname.store(name);
+	}
+}
+
+SIDtracescope::SIDtracescope(const char* name, const char* category) :
+	m_name(name),
+	m_category(category),
+	m_start(traceActive() ? traceNow() : -1)
+{
+}
+SIDtracescope::~SIDtracescope()
+{
+	if (m_start < 0) {
+		return;
+	}
+	long long end = traceNow();
+	// a full trace drops the newest events rather than stall the caller
+	std::atomic<size_t>& traceEvents = traceState().events;
+	if (traceEvents.fetch_add(1, std::memory_order_relaxed) >= TRACE_MAXEVENTS) {
+		traceEvents.fetch_sub(1, std::memory_order_relaxed);
+		return;
+	}
+	TRACEbuffer* buffer = threadBuffer();
+	size_t index = buffer->count.load(std::memory_order_relaxed);
+	size_t chunk = index / TRACE_CHUNK;
+	TRACEevent* events = buffer->chunks[chunk].load(std::memory_order_relaxed);
+	if (!events) {
+		events = new TRACEevent[TRACE_CHUNK];
+		buffer->chunks[chunk].store(events, std::memory_order_relaxed);
+	}
+	TRACEevent& event = events[index % TRACE_CHUNK];
+	event.name = m_name;
+	event.category = m_category;
+	event.start = m_start;
+	event.duration = end - m_start;
+	buffer->count.store(index + 1, std::memory_order_release);
+}
+
+static void writeThreadname(FILE* file, int tid, const char* threadName) {
+	if (threadName) {
+		fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", tid, threadName);
+	}
+}
+static void writeEvent(FILE* file, int tid, const TRACEevent& event) {
+	fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+		event.name, event.category, event.start / 1000.0, event.duration / 1000.0, tid);
+}
+
+bool traceWrite(const std::string& fileName) {
+	TRACEstate& state = traceState();
+	std::lock_guard<std::mutex> lock(state.lock);
+	FILE* file = fopen(fileName.c_str(), "w");
+	if (!file) {
+		return false;
+	}
+	fprintf(file, "{\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"SIDevo\"}}");
+	for (const TRACEfinished& finished : state.finished) {
+		writeThreadname(file, finished.tid, finished.threadname);
+		for (const TRACEevent& event : finished.events) {
+			writeEvent(file, finished.tid, event);
+		}
+	}
+	for (const std::unique_ptr<TRACEbuffer>& buffer : state.buffers) {
+		writeThreadname(file, buffer->tid, buffer->threadname.load());
+		// events up to count are complete, the owner may be adding more while this runs
+		size_t count = buffer->count.load(std::memory_order_acquire);
+		for (size_t index = 0; index < count; index++) {
+			writeEvent(file, buffer->tid, buffer->chunks[index / TRACE_CHUNK].load(std::memory_order_relaxed)[index % TRACE_CHUNK]);
+		}
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	return fclose(file) == 0;
+}
@@ -0,0 +1,26 @@
+// XMPlay SIDevo input plugin - Chrome trace-event timeline of plugin calls
+#pragma once
+
+#include <string>
+
+// start or stop recording, events of all threads share one clock from the first start
+void traceEnable(bool enable);
+bool traceActive();
+// label the calling thread in the timeline, the name must outlive the trace
+void traceThreadname(const char* name);
+// write everything recorded so far as Chrome trace-event JSON
+bool traceWrite(const std::string& fileName);
+
+// one complete event from construction to destruction, on the calling thread's own buffer
+class SIDtracescope
+{
+private:
+	const char* m_name;
+	const char* m_category;
+	long long m_start;
+
+public:
+	// name and category must be string literals, only the pointers are kept
+	SIDtracescope(const char* name, const char* category);
+	~SIDtracescope();
+};
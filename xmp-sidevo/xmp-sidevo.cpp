@@ -10,16 +10,22 @@ static XMPFUNC_TEXT* xmpftext;
 static XMPFUNC_REGISTRY* xmpfreg;
 
 #include "xmp-sidevo.h"
+#include "convert.h"
+#include "lengthdetect.h"
+#include "trace.h"
 #include "utils/SidDatabase.h"
 #include "utils/STILview/stil.h"
 #include <builders/residfp-builder/residfp.h>
+#include <builders/resid-builder/resid.h>
 #include <sidplayfp/SidInfo.h>
 #include <sidplayfp/SidTune.h>
 #include <sidplayfp/SidTuneInfo.h>
 #include <sidplayfp/sidplayfp.h>
 #include <sidid.h>
 
+#ifndef SIDEVO_HEADLESS
 #include <commctrl.h>
+#endif
 #include <assert.h>
 #include <cmath>
 #include <stdio.h>
@@ -34,7 +40,16 @@ static XMPFUNC_REGISTRY* xmpfreg;
 #include <iterator>
 #include <functional>
 #include <cctype>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <sys/stat.h>
+#ifndef SIDEVO_HEADLESS
 #include <shlobj.h>
+#endif
 
 #ifndef _WIN32
 #include <libgen.h>
@@ -46,21 +61,108 @@ static XMPFUNC_REGISTRY* xmpfreg;
 static HINSTANCE ghInstance;
 
 // fancy data containers
+typedef struct
+{
+	std::string path;
+	long long size;
+	long long mtime;
+	unsigned long long hash;
+} SIDsource;
+
+// database generations, rebuilt whole and swapped in when their source changes
+typedef struct
+{
+	SidDatabase base;
+	std::mutex lock;
+} SIDsongbase;
+typedef struct
+{
+	STIL base;
+	std::mutex lock;
+} SIDstilbase;
+
+// song-length detection job, keyed by the tune md5
+typedef struct
+{
+	std::string md5;
+	std::vector<uint8_t> tune;
+	bool lengths;
+	bool loops;
+	// the settings when the tune was queued, the worker never reads sidSetting
+	bool forcelength;
+	bool ntsc;
+	bool lockclock;
+} SIDdetectjob;
+
+// playback profile, Process time per stage summed over the song
+#define PROFILE_EMULATION 0
+#define PROFILE_LOOPCACHE 1
+#define PROFILE_SILENCE 2
+#define PROFILE_CONVERSION 3
+#define PROFILE_STAGES 4
+// Process time as a share of the audio time asked for, 8 buckets per doubling from 1/65536 up
+#define LATENCY_SUBBUCKETS 8
+#define LATENCY_MINEXP -16
+#define LATENCY_BUCKETS 200
+// quality governor tiers, each one cheaper than the last
+#define GOVERNOR_FULL 0
+#define GOVERNOR_NORMAL 1
+#define GOVERNOR_NOFILTER 2
+// share of the playing time spent in Process, smoothed over a couple of seconds of audio
+#define GOVERNOR_WINDOW 2.0
+#define GOVERNOR_STEPDOWN 0.75
+#define GOVERNOR_STEPUP 0.25
+// seconds of audio played between two switches
+#define GOVERNOR_HOLD 5.0
+typedef struct
+{
+	double stage[PROFILE_STAGES];
+	double total;
+	double audio;
+	double worst;
+	double worstaudio;
+	double worstratio;
+	long long blocks;
+	long long misses;
+	long long latency[LATENCY_BUCKETS];
+} SIDprofile;
+
 typedef struct
 {
 	sidplayfp* m_engine;
-	ReSIDfpBuilder* m_builder;
+	sidbuilder* m_builder;
 	SidTune* p_song;
 	SidConfig m_config;
-	SidDatabase d_songdbase;
-	STIL d_stilbase;
-	SidId d_sididbase;
-	bool d_loadeddbase;
-	bool d_loadedstil;
-	bool d_loadedsidid;
+	std::shared_ptr<SIDsongbase> d_songdbase;
+	std::shared_ptr<SIDstilbase> d_stilbase;
+	SIDsource d_songsource;
+	SIDsource d_stilsource;
+	SIDsource d_bugsource;
+	std::shared_ptr<SidId> d_sididbase;
+	std::mutex d_loadlock;
+	std::atomic<bool> d_loading;
+	std::atomic<DWORD> d_requested;
+	std::thread d_loader;
+	std::mutex d_statuslock;
+	std::vector<std::string> d_status;
+	std::map<std::string, std::vector<int>> d_detectcache;
+	std::map<std::string, std::vector<SIDloop>> d_loopcache;
+	std::vector<SIDdetectjob> d_detectjobs;
+	std::mutex d_detectlock;
+	std::atomic<bool> d_detecting;
+	std::thread d_detector;
+	std::atomic<bool> d_stop;
+	// held while a worker handle is joined or replaced, a worker clears its busy flag before that is done
+	std::mutex d_workerlock;
+	std::atomic<int> d_detectgen;
+	bool d_detectloaded;
 	char p_sididplayer[50];
 	char p_sididplayers[250];
 	const SidTuneInfo* p_songinfo;
+	std::vector<uint8_t> p_songbuf;
+	std::shared_ptr<SIDsongbase> p_songgen;
+	std::shared_ptr<SidId> p_sididgen;
+	int p_detectgen;
 	int p_songcount;
 	int p_subsong;
 	int p_defsubsong;
@@ -71,7 +173,7 @@ typedef struct
 	char p_clockspeed[10];
 	bool b_loaded;
 	bool b_reloadcfg = false;
-	bool b_noerr = false;
+	std::atomic<bool> b_noerr{ false };
 
 	int o_sidchips;
 	char o_sidmodel[10];
@@ -81,7 +183,32 @@ typedef struct
 	float fadein;
 	float fadeout;
 	int fadeouttrigger;
+	bool fadedout;
 	bool skiptrigger;
+
+	bool trimlead;
+	bool trimheard;
+	int trimsilent;
+	int p_leadtrim;
+	int p_trimend;
+
+	SIDloop p_loop;
+	int p_loopstate;
+	std::vector<short> p_loopbuf;
+	size_t p_looppos;
+	size_t p_loopseam;
+	long long p_loopreplayed;
+
+	bool p_profiling;
+	double p_stagetime[PROFILE_STAGES];
+	SIDprofile p_profile;
+	std::mutex p_profilelock;
+
+	int g_tier;
+	bool g_filter;
+	int g_switches;
+	double g_load;
+	double g_hold;
 } SIDengine;
 static SIDengine sidEngine;
 
@@ -92,11 +219,13 @@ typedef struct
 	int c_powerdelay;
 	int c_defaultlength;
 	int c_minlength;
+	int c_silencesec;
 	int c_6581filter;
 	int c_8580filter;
 	int c_fadeinms;
 	int c_fadeoutms;
 	char c_samplemethod[10];
+	char c_sidengine[10];
 	char c_dbpath[250];
 	bool c_locksidmodel;
 	bool c_lockclockspeed;
@@ -114,9 +243,31 @@ typedef struct
 	bool c_addfadeout;
 	bool c_subsongstil;
 	bool c_forcemono;
+	bool c_detectlength;
+	bool c_trimsilence;
+	bool c_loopcache;
+	bool c_profile;
+	bool c_governor;
+	bool c_trace;
 } SIDsetting;
 static SIDsetting sidSetting;
 
+// adds the time until it goes out of scope to one stage of the current Process call
+class SIDstagetimer
+{
+private:
+	int m_stage;
+	std::chrono::steady_clock::time_point m_start;
+
+public:
+	SIDstagetimer(int stage) : m_stage(sidEngine.p_profiling ? stage : -1) {
+		if (m_stage >= 0) m_start = std::chrono::steady_clock::now();
+	}
+	~SIDstagetimer() {
+		if (m_stage >= 0) sidEngine.p_stagetime[m_stage] += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+	}
+};
+
 // pretty up the format
 static const char* simpleFormat(const char* songFormat) {
 	if (std::string(songFormat).find("PSID") != std::string::npos) {
@@ -151,9 +302,11 @@ static void loadConfig()
 		strncpy(sidSetting.c_sidmodel, "6581", 10);
 		strncpy(sidSetting.c_clockspeed, "PAL", 10);
 		strncpy(sidSetting.c_samplemethod, "Normal", 10);
+		strncpy(sidSetting.c_sidengine, "ReSIDfp", 10);
 		strncpy(sidSetting.c_dbpath, "", 250);
 		sidSetting.c_defaultlength = 120;
 		sidSetting.c_minlength = 3;
+		sidSetting.c_silencesec = 5;
 		sidSetting.c_6581filter = 25;
 		sidSetting.c_8580filter = 50;
 		sidSetting.c_powerdelay = 0;
@@ -175,13 +328,21 @@ static void loadConfig()
 		sidSetting.c_addfadeout = FALSE;
 		sidSetting.c_subsongstil = FALSE;
 		sidSetting.c_forcemono = FALSE;
+		sidSetting.c_detectlength = FALSE;
+		sidSetting.c_trimsilence = FALSE;
+		sidSetting.c_loopcache = FALSE;
+		sidSetting.c_profile = FALSE;
+		sidSetting.c_governor = FALSE;
+		sidSetting.c_trace = FALSE;
 
 		if (xmpfreg->GetString("SIDevo", "c_sidmodel", sidSetting.c_sidmodel, 10) != 0) {
 			xmpfreg->GetString("SIDevo", "c_clockspeed", sidSetting.c_clockspeed, 10);
 			xmpfreg->GetString("SIDevo", "c_samplemethod", sidSetting.c_samplemethod, 10);
+			xmpfreg->GetString("SIDevo", "c_sidengine", sidSetting.c_sidengine, 10);
 			xmpfreg->GetString("SIDevo", "c_dbpath", sidSetting.c_dbpath, 250);
 			xmpfreg->GetInt("SIDevo", "c_defaultlength", &sidSetting.c_defaultlength);
 			xmpfreg->GetInt("SIDevo", "c_minlength", &sidSetting.c_minlength);
+			xmpfreg->GetInt("SIDevo", "c_silencesec", &sidSetting.c_silencesec);
 			xmpfreg->GetInt("SIDevo", "c_6581filter", &sidSetting.c_6581filter);
 			xmpfreg->GetInt("SIDevo", "c_8580filter", &sidSetting.c_8580filter);
 			xmpfreg->GetInt("SIDevo", "c_powerdelay", &sidSetting.c_powerdelay);
@@ -221,9 +382,32 @@ static void loadConfig()
 				sidSetting.c_subsongstil = ival;
 			if (xmpfreg->GetInt("SIDevo", "c_forcemono", &ival))
 				sidSetting.c_forcemono = ival;
+			if (xmpfreg->GetInt("SIDevo", "c_detectlength", &ival))
+				sidSetting.c_detectlength = ival;
+			if (xmpfreg->GetInt("SIDevo", "c_trimsilence", &ival))
+				sidSetting.c_trimsilence = ival;
+			if (xmpfreg->GetInt("SIDevo", "c_loopcache", &ival))
+				sidSetting.c_loopcache = ival;
+			if (xmpfreg->GetInt("SIDevo", "c_profile", &ival))
+				sidSetting.c_profile = ival;
+			if (xmpfreg->GetInt("SIDevo", "c_governor", &ival))
+				sidSetting.c_governor = ival;
+			if (xmpfreg->GetInt("SIDevo", "c_trace", &ival))
+				sidSetting.c_trace = ival;
 		}
 	}
 }
+// the configured sampling method, Normal while the governor has stepped down
+static SidConfig::sampling_method_t governedSampling() {
+	if (sidEngine.g_tier < GOVERNOR_NORMAL && std::string(sidSetting.c_samplemethod).find("Accurate") != std::string::npos) {
+		return SidConfig::RESAMPLE_INTERPOLATE;
+	}
+	return SidConfig::INTERPOLATE;
+}
+// the configured filter, off while the governor is at its lowest tier
+static bool governedFilter() {
+	return sidSetting.c_enablefilter && sidEngine.g_tier < GOVERNOR_NOFILTER;
+}
 static bool applyConfig(bool initThis) {
 	if (initThis) {
 		sidEngine.m_config = sidEngine.m_engine->config();
@@ -250,11 +434,7 @@ static bool applyConfig(bool initThis) {
 		}
 
 		// apply sample method
-		if (std::string(sidSetting.c_samplemethod).find("Normal") != std::string::npos) {
-			sidEngine.m_config.samplingMethod = SidConfig::INTERPOLATE;
-		} else if (std::string(sidSetting.c_samplemethod).find("Accurate") != std::string::npos) {
-			sidEngine.m_config.samplingMethod = SidConfig::RESAMPLE_INTERPOLATE;
-		}
+		sidEngine.m_config.samplingMethod = governedSampling();
 
 		// apply sid model & clock speed lock
 		sidEngine.m_config.forceSidModel = sidSetting.c_locksidmodel;
@@ -262,16 +442,18 @@ static bool applyConfig(bool initThis) {
 
 		// apply digi boost
 		sidEngine.m_config.digiBoost = sidSetting.c_enabledigiboost;
-	} else {
-		sidEngine.b_reloadcfg = true;
 	}
 
-	// apply filter status & levels
-	sidEngine.m_builder->filter(sidSetting.c_enablefilter);
-	float temp6581set = (float)sidSetting.c_6581filter / 100;
-	sidEngine.m_builder->filter6581Curve(temp6581set);
-	float temp8580set = (float)sidSetting.c_8580filter / 100;
-	sidEngine.m_builder->filter8580Curve(temp8580set);
+	// apply filter status & levels, reSID has no adjustable filter curves
+	sidEngine.g_filter = governedFilter();
+	sidEngine.m_builder->filter(sidEngine.g_filter);
+	ReSIDfpBuilder* residfpBuilder = dynamic_cast<ReSIDfpBuilder*>(sidEngine.m_builder);
+	if (residfpBuilder) {
+		float temp6581set = (float)sidSetting.c_6581filter / 100;
+		residfpBuilder->filter6581Curve(temp6581set);
+		float temp8580set = (float)sidSetting.c_8580filter / 100;
+		residfpBuilder->filter8580Curve(temp8580set);
+	}
 
 	// apply config
 	sidEngine.b_noerr = false;
@@ -286,6 +468,7 @@ static void saveConfig()
 {
 	xmpfreg->SetString("SIDevo", "c_sidmodel", sidSetting.c_sidmodel);
 	xmpfreg->SetString("SIDevo", "c_samplemethod", sidSetting.c_samplemethod);
+	xmpfreg->SetString("SIDevo", "c_sidengine", sidSetting.c_sidengine);
 	xmpfreg->SetString("SIDevo", "c_dbpath", sidSetting.c_dbpath);
 	xmpfreg->SetString("SIDevo", "c_clockspeed", sidSetting.c_clockspeed);
 	xmpfreg->SetInt("SIDevo", "c_powerdelay", &sidSetting.c_powerdelay);
@@ -293,6 +476,7 @@ static void saveConfig()
 	xmpfreg->SetInt("SIDevo", "c_8580filter", &sidSetting.c_8580filter);
 	xmpfreg->SetInt("SIDevo", "c_defaultlength", &sidSetting.c_defaultlength);
 	xmpfreg->SetInt("SIDevo", "c_minlength", &sidSetting.c_minlength);
+	xmpfreg->SetInt("SIDevo", "c_silencesec", &sidSetting.c_silencesec);
 	xmpfreg->SetInt("SIDevo", "c_fadeinms", &sidSetting.c_fadeinms);
 	xmpfreg->SetInt("SIDevo", "c_fadeoutms", &sidSetting.c_fadeoutms);
 
@@ -329,8 +513,21 @@ static void saveConfig()
 	xmpfreg->SetInt("SIDevo", "c_subsongstil", &ival);
 	ival = sidSetting.c_forcemono;
 	xmpfreg->SetInt("SIDevo", "c_forcemono", &ival);
+	ival = sidSetting.c_detectlength;
+	xmpfreg->SetInt("SIDevo", "c_detectlength", &ival);
+	ival = sidSetting.c_trimsilence;
+	xmpfreg->SetInt("SIDevo", "c_trimsilence", &ival);
+	ival = sidSetting.c_loopcache;
+	xmpfreg->SetInt("SIDevo", "c_loopcache", &ival);
+	ival = sidSetting.c_profile;
+	xmpfreg->SetInt("SIDevo", "c_profile", &ival);
+	ival = sidSetting.c_governor;
+	xmpfreg->SetInt("SIDevo", "c_governor", &ival);
+	ival = sidSetting.c_trace;
+	xmpfreg->SetInt("SIDevo", "c_trace", &ival);
 
 	if (sidEngine.b_loaded) {
+		sidEngine.b_reloadcfg = true;
 		applyConfig(FALSE);
 	}
 }
@@ -342,6 +539,24 @@ static inline std::string& trim(std::string& s) {
 		std::not1(std::ptr_fun<int, int>(std::isspace))).base(), s.end());
 	return s;
 }
+// resolve the HVSC DOCUMENTS path
+static std::string docsPath() {
+	std::string relpathName;
+	if ((sidSetting.c_dbpath[0]) == '.') {
+		TCHAR exepathName[FILENAME_MAX];
+		GetModuleFileName(nullptr, exepathName, FILENAME_MAX);
+		std::string::size_type slashPos = std::string(exepathName).find_last_of("\\/");
+		relpathName = std::string(exepathName).substr(0, slashPos);
+		relpathName.append("/");
+		relpathName.append(sidSetting.c_dbpath);
+		relpathName.append("/");
+	} else {
+		relpathName = sidSetting.c_dbpath;
+		relpathName.append("/");
+	}
+	return relpathName;
+}
+#ifndef SIDEVO_HEADLESS
 // test and folder functions for settings dialog
 int CALLBACK callbackFolder(HWND hwnd, UINT uMsg, LPARAM lParam, LPARAM lpData) {
 	LPITEMIDLIST pidlNavigate;
@@ -379,18 +594,7 @@ static std::string pathTest() {
 	std::string relpathName, testpathName, pathState;
 
 	// get dll path
-	if ((sidSetting.c_dbpath[0]) == '.') {
-		TCHAR exepathName[FILENAME_MAX];
-		GetModuleFileName(nullptr, exepathName, FILENAME_MAX);
-		std::string::size_type slashPos = std::string(exepathName).find_last_of("\\/");
-		relpathName = std::string(exepathName).substr(0, slashPos);
-		relpathName.append("/");
-		relpathName.append(sidSetting.c_dbpath);
-		relpathName.append("/");
-	} else {
-		relpathName = sidSetting.c_dbpath;
-		relpathName.append("/");
-	}
+	relpathName = docsPath();
 
 	// test songlengths
 	testpathName = relpathName;
@@ -414,10 +618,24 @@ static std::string pathTest() {
 
 	return pathState;
 }
+#endif
+
+// queue errors for the general info panel, message boxes would block whichever thread hit them
+static void statusMessage(const char* statusTitle, const std::string& statusText) {
+	std::lock_guard<std::mutex> statusLock(sidEngine.d_statuslock);
+	std::string statusLine = std::string(statusTitle).append(": ").append(statusText);
+	if (std::find(sidEngine.d_status.begin(), sidEngine.d_status.end(), statusLine) == sidEngine.d_status.end()) {
+		if (sidEngine.d_status.size() >= 5) {
+			sidEngine.d_status.erase(sidEngine.d_status.begin());
+		}
+		sidEngine.d_status.push_back(statusLine);
+	}
+}
 
 // functions to load and fetch the SIDId
 static void loadSIDId() {
-	if (sidSetting.c_detectplayer && !sidEngine.d_loadedsidid) {
+	SIDtracescope traceScope("SIDId", "database");
+	if (sidSetting.c_detectplayer && !std::atomic_load(&sidEngine.d_sididbase)) {
 		TCHAR pluginPath[FILENAME_MAX];
 		std::string configPath;
 		GetModuleFileName(ghInstance, pluginPath, FILENAME_MAX);
@@ -427,21 +645,25 @@ static void loadSIDId() {
 
 		if (FILE* file = fopen(configPath.c_str(), "r")) {
 			fclose(file);
-			sidEngine.d_loadedsidid = sidEngine.d_sididbase.readConfigFile(configPath);
-		} else if (!sidEngine.b_noerr) {
-			sidEngine.b_noerr = true;
-			MessageBoxA(0, "Unable to find sidid.cfg in the plugin folder, disable detect music player if you would prefer not to use SIDid.", "sidid.cfg Not Found", MB_OK);
+			std::shared_ptr<SidId> sididGen = std::make_shared<SidId>();
+			if (sididGen->readConfigFile(configPath)) {
+				std::atomic_store(&sidEngine.d_sididbase, sididGen);
+			}
+		} else if (!sidEngine.b_noerr.exchange(true)) {
+			statusMessage("sidid.cfg Not Found", "Unable to find sidid.cfg in the plugin folder, disable detect music player if you would prefer not to use SIDid.");
 		}
 	}
 }
 static void fetchSIDId(std::vector<uint8_t>& c64buf) {
-	if (sidEngine.d_loadedsidid) {
+	std::shared_ptr<SidId> sididGen = std::atomic_load(&sidEngine.d_sididbase);
+	sidEngine.p_sididgen = sididGen;
+	strncpy(sidEngine.p_sididplayer, "", 50);
+	strncpy(sidEngine.p_sididplayers, "", 250);
+	if (sididGen) {
 		// adapted sidid code, could be more efficient
 		std::string c64player;
-		c64player = sidEngine.d_sididbase.identify(c64buf);
+		c64player = sididGen->identify(c64buf);
 
-		strncpy(sidEngine.p_sididplayer, "", 50);
-		strncpy(sidEngine.p_sididplayers, "", 250);
 		if (sizeof(c64player) > 0) {
 			while (c64player.find("_") != -1)
 				c64player.replace(c64player.find("_"), 1, " ");
@@ -456,30 +678,131 @@ static void fetchSIDId(std::vector<uint8_t>& c64buf) {
 		}
 	}
 }
-// functions to load and fetch the songlengthdbase
-static void loadSonglength() {
-	if (!sidSetting.c_forcelength && !sidEngine.d_loadeddbase && strlen(sidSetting.c_dbpath) > 10) {
-		std::string relpathName;
-		if ((sidSetting.c_dbpath[0]) == '.') {
-			TCHAR exepathName[FILENAME_MAX];
-			GetModuleFileName(nullptr, exepathName, FILENAME_MAX);
-			std::string::size_type slashPos = std::string(exepathName).find_last_of("\\/");
-			relpathName = std::string(exepathName).substr(0, slashPos);
-			relpathName.append("/");
-			relpathName.append(sidSetting.c_dbpath);
-			relpathName.append("/");
-		} else {
-			relpathName = sidSetting.c_dbpath;
-			relpathName.append("/");
+// functions to detect changed database sources, so HVSC updates apply without a restart
+static unsigned long long sourceHash(const std::string& fileName) {
+	// FNV-1a over the whole file
+	unsigned long long fileHash = 14695981039346656037ULL;
+	if (FILE* file = fopen(fileName.c_str(), "rb")) {
+		std::vector<unsigned char> hashBuf(65536);
+		size_t hashRead;
+		while ((hashRead = fread(hashBuf.data(), 1, hashBuf.size(), file)) > 0) {
+			for (size_t i = 0; i < hashRead; i++) {
+				fileHash = (fileHash ^ hashBuf[i]) * 1099511628211ULL;
+			}
+		}
+		fclose(file);
+	}
+	return fileHash;
+}
+static bool sourceChanged(SIDsource* dbSource, const std::string& fileName) {
+	struct stat fileInfo;
+	if (stat(fileName.c_str(), &fileInfo) != 0) {
+		return false;
+	}
+	if (dbSource->path == fileName && dbSource->size == fileInfo.st_size && dbSource->mtime == fileInfo.st_mtime) {
+		return false;
+	}
+
+	// size or mtime moved, only rebuild if the contents really differ
+	unsigned long long fileHash = sourceHash(fileName);
+	bool fileChanged = dbSource->path != fileName || dbSource->hash != fileHash;
+	dbSource->path = fileName;
+	dbSource->size = fileInfo.st_size;
+	dbSource->mtime = fileInfo.st_mtime;
+	dbSource->hash = fileHash;
+	return fileChanged;
+}
+// a file next to the plugin
+static std::string pluginFile(const char* fileName) {
+	TCHAR pluginPath[FILENAME_MAX];
+	std::string filePath;
+	GetModuleFileName(ghInstance, pluginPath, FILENAME_MAX);
+	std::string::size_type slashPos = std::string(pluginPath).find_last_of("\\/");
+	filePath = std::string(pluginPath).substr(0, slashPos + 1);
+	filePath.append(fileName);
+	return filePath;
+}
+// start or stop the call timeline, stopping writes out what was recorded
+static void applyTrace() {
+	if (!sidSetting.c_trace && traceActive()) {
+		traceEnable(false);
+		traceWrite(pluginFile("sidevo-trace.json"));
+	} else {
+		traceEnable(sidSetting.c_trace);
+	}
+}
+// functions to load, save and fetch detected song lengths, cached by md5 next to the plugin
+static std::string detectPath() {
+	return pluginFile("sidevo-lengths.md5");
+}
+static void loadDetectcache() {
+	SIDtracescope traceScope("Detect cache", "database");
+	std::lock_guard<std::mutex> detectLock(sidEngine.d_detectlock);
+	if (sidEngine.d_detectloaded) {
+		return;
+	}
+	sidEngine.d_detectloaded = true;
+
+	// same layout as Songlengths.md5, md5=m:ss m:ss ...
+	std::ifstream cacheFile(detectPath());
+	std::string cacheLine;
+	while (std::getline(cacheFile, cacheLine)) {
+		std::string::size_type equalPos = cacheLine.find('=');
+		if (equalPos == std::string::npos || cacheLine[0] == ';') {
+			continue;
+		}
+		std::vector<int> cacheLengths;
+		std::istringstream lengthStr(cacheLine.substr(equalPos + 1));
+		std::string lengthTxt;
+		while (lengthStr >> lengthTxt) {
+			int lengthMin = 0, lengthSec = 0;
+			sscanf(lengthTxt.c_str(), "%d:%d", &lengthMin, &lengthSec);
+			cacheLengths.push_back(lengthMin * 60 + lengthSec);
+		}
+		sidEngine.d_detectcache[cacheLine.substr(0, equalPos)] = cacheLengths;
+	}
+	if (!sidEngine.d_detectcache.empty()) {
+		sidEngine.d_detectgen++;
+	}
+}
+static void saveDetectcache(const std::string& md5, const std::vector<int>& detectLengths) {
+	if (FILE* file = fopen(detectPath().c_str(), "a")) {
+		fprintf(file, "%s=", md5.c_str());
+		for (size_t si = 0; si < detectLengths.size(); si++) {
+			fprintf(file, si ? " %d:%02d" : "%d:%02d", detectLengths[si] / 60, detectLengths[si] % 60);
 		}
+		fprintf(file, "\n");
+		fclose(file);
+	}
+}
+static int fetchDetectedlength(const char* md5, int sidSubsong) {
+	std::lock_guard<std::mutex> detectLock(sidEngine.d_detectlock);
+	std::map<std::string, std::vector<int>>::iterator detectEntry = sidEngine.d_detectcache.find(md5);
+	if (detectEntry != sidEngine.d_detectcache.end() && sidSubsong <= (int)detectEntry->second.size()) {
+		return detectEntry->second[sidSubsong - 1];
+	}
+	return 0;
+}
 
+// functions to load and fetch the songlengthdbase
+static void loadSonglength() {
+	SIDtracescope traceScope("Songlengths", "database");
+	if (!sidSetting.c_forcelength && strlen(sidSetting.c_dbpath) > 10) {
+		std::string relpathName = docsPath();
 		relpathName.append("Songlengths.md5");
 		if (FILE* file = fopen(relpathName.c_str(), "r")) {
 			fclose(file);
-			sidEngine.d_loadeddbase = sidEngine.d_songdbase.open(relpathName.c_str());
-		} else if (!sidEngine.b_noerr){
-			sidEngine.b_noerr = true;
-			MessageBoxA(0, relpathName.c_str(), "Songlengths.md5 Path Invalid", MB_OK);
+			if (sourceChanged(&sidEngine.d_songsource, relpathName)) {
+				// build the new generation aside, lookups keep using the old one until the swap
+				std::shared_ptr<SIDsongbase> songGen = std::make_shared<SIDsongbase>();
+				if (songGen->base.open(relpathName.c_str())) {
+					std::atomic_store(&sidEngine.d_songdbase, songGen);
+				} else {
+					sidEngine.d_songsource.path.clear();
+				}
+			}
+		} else if (!sidEngine.b_noerr.exchange(true)) {
+			statusMessage("Songlengths.md5 Path Invalid", relpathName);
 		}
 	}
 }
@@ -489,17 +812,28 @@ static int fetchSonglength(SidTune* sidSong, int sidSubsong) {
 	int32_t debug2 = 0;
 	int32_t defaultduration = sidSetting.c_defaultlength;
 
-	if (!sidSetting.c_forcelength && sidEngine.d_loadeddbase) {
+	std::shared_ptr<SIDsongbase> songGen = std::atomic_load(&sidEngine.d_songdbase);
+	if (!sidSetting.c_forcelength && songGen) {
 		sidSong->createMD5New(md5);
 		if (strlen(md5) > 0) {
 			//md5duration = sidEngine.d_songdbase.length(md5, sidSubsong);
-			md5duration = sidEngine.d_songdbase.lengthMs(md5, sidSubsong);
+			std::lock_guard<std::mutex> songLock(songGen->lock);
+			md5duration = songGen->base.lengthMs(md5, sidSubsong);
 		}
 		if (md5duration > 0) {
 			defaultduration = ((md5duration + 999) / 1000);
 		}
 	}
 
+	// not in the database, use a detected length if there is one
+	if (md5duration <= 0 && sidSetting.c_detectlength) {
+		sidSong->createMD5New(md5);
+		int detectduration = fetchDetectedlength(md5, sidSubsong);
+		if (detectduration > 0) {
+			defaultduration = detectduration;
+		}
+	}
+
 	return defaultduration;
 }
 // get song's tags
@@ -530,29 +864,241 @@ static char* GetTags(const SidTuneInfo* p_songinfo)
 }
 // try to load STIL database
 static void loadSTILbase() {
-	if (!sidEngine.d_loadedstil && strlen(sidSetting.c_dbpath) > 10) {
-		std::string relpathName;
-		if ((sidSetting.c_dbpath[0]) == '.') {
-			TCHAR exepathName[FILENAME_MAX];
-			GetModuleFileName(nullptr, exepathName, FILENAME_MAX);
-			std::string::size_type slashPos = std::string(exepathName).find_last_of("\\/");
-			relpathName = std::string(exepathName).substr(0, slashPos);
-			relpathName.append("/");
-			relpathName.append(sidSetting.c_dbpath);
-
-			char abspathName[_MAX_PATH];
-			_fullpath(abspathName, relpathName.c_str(), _MAX_PATH);
+	SIDtracescope traceScope("STIL", "database");
+	if (strlen(sidSetting.c_dbpath) > 10) {
+		// the STIL wants the HVSC folder above DOCUMENTS
+		std::string relpathName = docsPath();
+		relpathName.erase(relpathName.find_last_not_of("\\/") + 1);
+		relpathName.erase(relpathName.length() - 9);
+		char abspathName[_MAX_PATH];
+		if (_fullpath(abspathName, relpathName.c_str(), _MAX_PATH) != NULL) {
 			relpathName = abspathName;
+		}
+
+		// STIL.txt and BUGlist.txt are rebuilt together, but only when either has changed
+		bool stilChanged = sourceChanged(&sidEngine.d_stilsource, docsPath().append("STIL.txt"));
+		stilChanged |= sourceChanged(&sidEngine.d_bugsource, docsPath().append("BUGlist.txt"));
+		if (!stilChanged && std::atomic_load(&sidEngine.d_stilbase)) {
+			return;
+		}
+
+		std::shared_ptr<SIDstilbase> stilGen = std::make_shared<SIDstilbase>();
+		if (stilGen->base.setBaseDir(relpathName.c_str())) {
+			std::atomic_store(&sidEngine.d_stilbase, stilGen);
 		} else {
-			relpathName = sidSetting.c_dbpath;
+			// keep serving the old generation, but try again on the next request
+			sidEngine.d_stilsource.path.clear();
+			sidEngine.d_bugsource.path.clear();
+			if (!std::atomic_load(&sidEngine.d_stilbase) && !sidEngine.b_noerr.exchange(true)) {
+				statusMessage("STIL Path Invalid", relpathName);
+			}
+		}
+	}
+}
+// input plugins get no exit call, so once a worker has been started the plugin stays loaded until XMPlay exits and
+// FreeLibrary can't unmap code a worker is still running
+static void pinWorkers() {
+#ifndef SIDEVO_HEADLESS
+	static bool pinned = false;
+	HMODULE pinModule;
+	if (!pinned) {
+		pinned = GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_PIN, (LPCSTR)&pinWorkers, &pinModule) != FALSE;
+	}
+#endif
+}
+// load the databases on a worker thread, open and file info never wait for them
+static void loadDatabases() {
+	traceThreadname("Database loader");
+	SIDtracescope traceScope("Load databases", "database");
+	std::lock_guard<std::mutex> loadLock(sidEngine.d_loadlock);
+	loadSIDId();
+	loadSonglength();
+	loadSTILbase();
+	if (sidSetting.c_detectlength) {
+		loadDetectcache();
+	}
+	sidEngine.d_loading = false;
+}
+static void requestDatabases() {
+	// only look for changes every few seconds, playlist scans call this for every file
+	DWORD requestTick = GetTickCount();
+	DWORD lastRequest = sidEngine.d_requested;
+	if (lastRequest && requestTick - lastRequest < 5000) {
+		return;
+	}
+	sidEngine.d_requested = requestTick ? requestTick : 1;
+
+	// the last loader has cleared d_loading on its way out, so joining it doesn't wait
+	bool loaderIdle = false;
+	if (!sidEngine.d_stop && sidEngine.d_loading.compare_exchange_strong(loaderIdle, true)) {
+		std::lock_guard<std::mutex> workerLock(sidEngine.d_workerlock);
+		pinWorkers();
+		if (sidEngine.d_loader.joinable()) {
+			sidEngine.d_loader.join();
+		}
+		sidEngine.d_loader = std::thread(loadDatabases);
+	}
+}
+// detect song lengths on a worker thread, each tune is emulated at most once
+static void detectSonglengths() {
+	traceThreadname("Length detection");
+	// the detector has its own engine, a recorder instead of a real SID so no audio is generated
+	RecorderBuilder detectBuilder("Recorder");
+	sidplayfp detectEngine;
+	detectEngine.setRoms(kernel, basic, chargen);
+	detectBuilder.create(detectEngine.info().maxsids());
+
+	SidConfig detectConfig = detectEngine.config();
+	detectConfig.frequency = 8000;
+	detectConfig.playback = SidConfig::MONO;
+	detectConfig.powerOnDelay = 0;
+	detectConfig.defaultC64Model = SidConfig::PAL;
+	detectConfig.forceC64Model = false;
+	detectConfig.sidEmulation = &detectBuilder;
+	if (!detectBuilder.getStatus() || !detectEngine.config(detectConfig)) {
+		statusMessage("Length Detection Failed", detectEngine.error());
+		std::lock_guard<std::mutex> detectLock(sidEngine.d_detectlock);
+		sidEngine.d_detectjobs.clear();
+		sidEngine.d_detecting = false;
+		return;
+	}
+
+	loadDetectcache();
+	for (;;) {
+		SIDdetectjob detectJob;
+		{
+			std::lock_guard<std::mutex> detectLock(sidEngine.d_detectlock);
+			if (sidEngine.d_detectjobs.empty() || sidEngine.d_stop) {
+				sidEngine.d_detecting = false;
+				return;
+			}
+			detectJob = sidEngine.d_detectjobs.front();
+			sidEngine.d_detectjobs.erase(sidEngine.d_detectjobs.begin());
+			detectJob.lengths = detectJob.lengths && !sidEngine.d_detectcache.count(detectJob.md5);
+			detectJob.loops = detectJob.loops && !sidEngine.d_loopcache.count(detectJob.md5);
 		}
 
-		relpathName.replace((relpathName.length() - 10), 10, "");
-		sidEngine.d_loadedstil = sidEngine.d_stilbase.setBaseDir(relpathName.c_str());
-		if (!sidEngine.d_loadedstil && !sidEngine.b_noerr) {
-			sidEngine.b_noerr = true;
-			MessageBoxA(0, relpathName.c_str(), "STIL Path Invalid", MB_OK);
+		// wait out a database load that is still running, HVSC tunes don't need detecting
+		{
+			std::lock_guard<std::mutex> loadLock(sidEngine.d_loadlock);
+		}
+		std::shared_ptr<SIDsongbase> songGen = std::atomic_load(&sidEngine.d_songdbase);
+		if (detectJob.lengths && !detectJob.forcelength && songGen) {
+			std::lock_guard<std::mutex> songLock(songGen->lock);
+			if (songGen->base.lengthMs(detectJob.md5.c_str(), 1) > 0) {
+				detectJob.lengths = false;
+			}
+		}
+		if (!detectJob.lengths && !detectJob.loops) {
+			continue;
+		}
+
+		// the clock the tune was queued with
+		const SidConfig::c64_model_t detectModel = detectJob.ntsc ? SidConfig::NTSC : SidConfig::PAL;
+		if (detectConfig.defaultC64Model != detectModel || detectConfig.forceC64Model != detectJob.lockclock) {
+			detectConfig.defaultC64Model = detectModel;
+			detectConfig.forceC64Model = detectJob.lockclock;
+			if (!detectEngine.config(detectConfig)) {
+				statusMessage("Length Detection Failed", detectEngine.error());
+				continue;
+			}
+		}
+
+		SIDtracescope traceScope("Detect", "detect");
+		SidTune detectSong(detectJob.tune.data(), detectJob.tune.size());
+		std::vector<int> detectLengths;
+		std::vector<SIDloop> detectLoops;
+		if (detectSong.getStatus()) {
+			for (unsigned int si = 1; si <= detectSong.getInfo()->songs(); si++) {
+				SIDloop detectLoop = {};
+				// looking for the exact loop keeps the stepper going after the length is known, only do it when asked
+				detectLengths.push_back(detectSonglength(&detectEngine, &detectBuilder, &detectSong, si, 900, detectJob.loops ? &detectLoop : nullptr, &detectJob.tune, &sidEngine.d_stop));
+				detectLoops.push_back(detectLoop);
+			}
+		}
+		// a stopped detection isn't a length, leave the tune for next time
+		if (sidEngine.d_stop) {
+			continue;
 		}
+		{
+			std::lock_guard<std::mutex> detectLock(sidEngine.d_detectlock);
+			if (detectJob.lengths) {
+				sidEngine.d_detectcache[detectJob.md5] = detectLengths;
+			}
+			if (detectJob.loops) {
+				sidEngine.d_loopcache[detectJob.md5] = detectLoops;
+			}
+		}
+		if (detectJob.lengths) {
+			saveDetectcache(detectJob.md5, detectLengths);
+		}
+		sidEngine.d_detectgen++;
+	}
+}
+static void requestDetection(SidTune* sidSong, const std::vector<uint8_t>& c64buf, bool detectLoops) {
+	bool detectLengths = sidSetting.c_detectlength;
+	if (!detectLengths && !detectLoops) {
+		return;
+	}
+	char md5[SidTune::MD5_LENGTH + 1];
+	sidSong->createMD5New(md5);
+	if (strlen(md5) == 0) {
+		return;
+	}
+
+	// tunes in the database already have a length
+	std::shared_ptr<SIDsongbase> songGen = std::atomic_load(&sidEngine.d_songdbase);
+	if (detectLengths && !sidSetting.c_forcelength && songGen) {
+		std::lock_guard<std::mutex> songLock(songGen->lock);
+		if (songGen->base.lengthMs(md5, 1) > 0) {
+			detectLengths = false;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> detectLock(sidEngine.d_detectlock);
+		detectLengths = detectLengths && !sidEngine.d_detectcache.count(md5);
+		detectLoops = detectLoops && !sidEngine.d_loopcache.count(md5);
+		if (!detectLengths && !detectLoops) {
+			return;
+		}
+		for (SIDdetectjob& detectJob : sidEngine.d_detectjobs) {
+			if (detectJob.md5 == md5) {
+				detectJob.lengths = detectJob.lengths || detectLengths;
+				detectJob.loops = detectJob.loops || detectLoops;
+				return;
+			}
+		}
+		SIDdetectjob detectJob;
+		detectJob.md5 = md5;
+		detectJob.tune = c64buf;
+		detectJob.lengths = detectLengths;
+		detectJob.loops = detectLoops;
+		detectJob.forcelength = sidSetting.c_forcelength;
+		detectJob.ntsc = std::string(sidSetting.c_clockspeed).find("NTSC") != std::string::npos;
+		detectJob.lockclock = sidSetting.c_lockclockspeed;
+		sidEngine.d_detectjobs.push_back(detectJob);
+	}
+	bool detectorIdle = false;
+	if (!sidEngine.d_stop && sidEngine.d_detecting.compare_exchange_strong(detectorIdle, true)) {
+		std::lock_guard<std::mutex> workerLock(sidEngine.d_workerlock);
+		pinWorkers();
+		if (sidEngine.d_detector.joinable()) {
+			sidEngine.d_detector.join();
+		}
+		sidEngine.d_detector = std::thread(detectSonglengths);
+	}
+}
+// stop the workers and wait for them, only from an explicit shutdown, never from static destruction where the loader
+// lock is held and a worker still finishing would deadlock the unload
+static void stopWorkers() {
+	sidEngine.d_stop = true;
+	std::lock_guard<std::mutex> workerLock(sidEngine.d_workerlock);
+	if (sidEngine.d_loader.joinable()) {
+		sidEngine.d_loader.join();
+	}
+	if (sidEngine.d_detector.joinable()) {
+		sidEngine.d_detector.join();
 	}
 }
 static void formatSTILbase(const char* stilData, char** buf) {
@@ -595,19 +1141,27 @@ static void formatSTILbase(const char* stilData, char** buf) {
 // initialise the plugin
 static void WINAPI SIDevo_Init()
 {
+	SIDtracescope traceScope("Init", "engine");
 	if (sidEngine.b_reloadcfg && sidEngine.b_loaded) {
 		delete sidEngine.m_builder;
 		delete sidEngine.m_engine;
 		sidEngine.b_loaded = FALSE;
 	}
 	if (!sidEngine.b_loaded) {
+		sidEngine.b_reloadcfg = false;
 		// set default config
 		loadConfig();
+		applyTrace();
 
 		// initialise the engine
 		sidEngine.m_engine = new sidplayfp();
 		sidEngine.m_engine->setRoms(kernel, basic, chargen);
-		sidEngine.m_builder = new ReSIDfpBuilder("ReSIDfp");
+		// reSID is the older, cheaper emulation, for machines that can't keep up with reSIDfp
+		if (!strcmp(sidSetting.c_sidengine, "ReSID")) {
+			sidEngine.m_builder = new ReSIDBuilder("ReSID");
+		} else {
+			sidEngine.m_builder = new ReSIDfpBuilder("ReSIDfp");
+		}
 		sidEngine.m_builder->create(sidEngine.m_engine->info().maxsids());
 		if (!sidEngine.m_builder->getStatus()) {
 			delete sidEngine.m_engine;
@@ -628,6 +1182,7 @@ static void WINAPI SIDevo_Init()
 // general purpose
 static BOOL WINAPI SIDevo_CheckFile(const char* filename, XMPFILE file)
 {
+	SIDtracescope traceScope("CheckFile", "xmpin");
 	// +PSID, +RSID, +MUS, -P00, -PRG, -DAT, +STR
 	std::string musExtension = ".mus";
 	std::string strExtension = ".str";
@@ -644,6 +1199,7 @@ static BOOL WINAPI SIDevo_CheckFile(const char* filename, XMPFILE file)
 }
 static DWORD WINAPI SIDevo_GetFileInfo(const char* filename, XMPFILE file, float** length, char** tags)
 {
+	SIDtracescope traceScope("GetFileInfo", "xmpin");
 	// reject invalid files
 	if (!SIDevo_CheckFile(filename, file)) {
 		return 0;
@@ -668,11 +1224,12 @@ static DWORD WINAPI SIDevo_GetFileInfo(const char* filename, XMPFILE file, float
 	lu_songcount = lu_songinfo->songs();
 	if (length) {
 		// load lengths
-		loadSonglength();
+		requestDatabases();
 		*length = (float*)xmpfmisc->Alloc(lu_songcount * sizeof(float));
 		for (int si = 1; si <= lu_songcount; si++) {
 			(*length)[si - 1] = fetchSonglength(lu_song, si);
 		}
+		requestDetection(lu_song, c64buf, false);
 	}
 	if (tags)
 		*tags = GetTags(lu_songinfo);
@@ -682,15 +1239,18 @@ static DWORD WINAPI SIDevo_GetFileInfo(const char* filename, XMPFILE file, float
 	return lu_songcount | XMPIN_INFO_NOSUBTAGS;
 }
 static DWORD WINAPI SIDevo_GetSubSongs(float* length) {
+	SIDtracescope traceScope("GetSubSongs", "xmpin");
 	*length = sidEngine.p_songlength;
 	return sidEngine.p_songcount;
 }
 static char* WINAPI SIDevo_GetTags()
 {
+	SIDtracescope traceScope("GetTags", "xmpin");
 	return GetTags(sidEngine.p_songinfo);
 }
 static void WINAPI SIDevo_GetInfoText(char* format, char* length)
 {
+	SIDtracescope traceScope("GetInfoText", "xmpin");
 	if (format) {
 		if (strlen(sidEngine.p_sididplayer) > 0)
 			sprintf(format, "%s - %s", simpleFormat(sidEngine.p_songinfo->formatString()), sidEngine.p_sididplayer);
@@ -704,8 +1264,125 @@ static void WINAPI SIDevo_GetInfoText(char* format, char* length)
 			sprintf(length, "%s - %s", sidEngine.p_sidmodel, sidEngine.p_clockspeed);
 	}
 }
+// functions to collect, show and save the playback profile
+static const char* profileStages[PROFILE_STAGES] = { "Emulation", "Loop cache", "Silence gate", "Conversion" };
+static void resetProfile() {
+	std::lock_guard<std::mutex> profileLock(sidEngine.p_profilelock);
+	sidEngine.p_profile = SIDprofile();
+	std::fill(sidEngine.p_stagetime, sidEngine.p_stagetime + PROFILE_STAGES, 0.0);
+}
+static int latencyBucket(double latencyRatio) {
+	if (latencyRatio <= 0) {
+		return 0;
+	}
+	int bucket = (int)std::floor((std::log2(latencyRatio) - LATENCY_MINEXP) * LATENCY_SUBBUCKETS);
+	return std::min(std::max(bucket, 0), LATENCY_BUCKETS - 1);
+}
+// the ratio a share of the blocks stayed under, the top of the bucket it falls in
+static double latencyPercentile(const SIDprofile& profile, double fraction) {
+	long long target = (long long)std::ceil(profile.blocks * fraction);
+	long long seen = 0;
+	for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+		seen += profile.latency[bucket];
+		if (seen >= target) {
+			return std::min(std::exp2(LATENCY_MINEXP + (bucket + 1.0) / LATENCY_SUBBUCKETS), profile.worstratio);
+		}
+	}
+	return profile.worstratio;
+}
+static void profileBlock(double blockTime, DWORD blockCount, DWORD blockDone) {
+	double blockAudio = (double)blockDone / (sidEngine.m_config.frequency * sidEngine.m_config.playback);
+	// the deadline is the playing time of what XMPlay asked for
+	double blockDeadline = (double)blockCount / (sidEngine.m_config.frequency * sidEngine.m_config.playback);
+	double latencyRatio = blockDeadline > 0 ? blockTime / blockDeadline : 0;
+	std::lock_guard<std::mutex> profileLock(sidEngine.p_profilelock);
+	for (int stage = 0; stage < PROFILE_STAGES; stage++) {
+		sidEngine.p_profile.stage[stage] += sidEngine.p_stagetime[stage];
+		sidEngine.p_stagetime[stage] = 0;
+	}
+	sidEngine.p_profile.total += blockTime;
+	sidEngine.p_profile.audio += blockAudio;
+	sidEngine.p_profile.blocks++;
+	if (blockTime > sidEngine.p_profile.worst) {
+		sidEngine.p_profile.worst = blockTime;
+		sidEngine.p_profile.worstaudio = blockAudio;
+	}
+	sidEngine.p_profile.latency[latencyBucket(latencyRatio)]++;
+	sidEngine.p_profile.worstratio = std::max(sidEngine.p_profile.worstratio, latencyRatio);
+	if (latencyRatio > 1) {
+		sidEngine.p_profile.misses++;
+	}
+}
+// move to another quality tier between two blocks, the sampling method and the filter follow on the next song,
+// reconfiguring mid-song would restart the tune and switching the filter mid-song clicks
+static void governTier(int tier) {
+	if (tier == sidEngine.g_tier) {
+		return;
+	}
+	sidEngine.g_tier = tier;
+	sidEngine.g_switches++;
+	sidEngine.g_hold = 0;
+}
+// step down while Process keeps using most of the playing time, and back up once there is headroom
+static void governBlock(double blockTime, DWORD blockDone) {
+	if (!sidSetting.c_governor) {
+		governTier(GOVERNOR_FULL);
+		return;
+	}
+	double blockAudio = (double)blockDone / (sidEngine.m_config.frequency * sidEngine.m_config.playback);
+	if (blockAudio <= 0) {
+		return;
+	}
+	sidEngine.g_load += (blockTime / blockAudio - sidEngine.g_load) * std::min(blockAudio / GOVERNOR_WINDOW, 1.0);
+	sidEngine.g_hold += blockAudio;
+	if (sidEngine.g_hold < GOVERNOR_HOLD) {
+		return;
+	}
+	if (sidEngine.g_load > GOVERNOR_STEPDOWN && sidEngine.g_tier < GOVERNOR_NOFILTER) {
+		governTier(sidEngine.g_tier + 1);
+	} else if (sidEngine.g_load < GOVERNOR_STEPUP && sidEngine.g_tier > GOVERNOR_FULL) {
+		governTier(sidEngine.g_tier - 1);
+	}
+}
+// realtime factor, share of each stage and the slowest block, separated by lineBreak
+static int formatProfile(char* buf, const char* lineBreak) {
+	std::lock_guard<std::mutex> profileLock(sidEngine.p_profilelock);
+	const SIDprofile& profile = sidEngine.p_profile;
+	if (!profile.blocks || profile.total <= 0) {
+		return sprintf(buf, "waiting for playback");
+	}
+	char* start = buf;
+	buf += sprintf(buf, "%.1fx realtime (%.1f s in %.3f s)", profile.audio / profile.total, profile.audio, profile.total);
+	double other = profile.total;
+	for (int stage = 0; stage < PROFILE_STAGES; stage++) {
+		buf += sprintf(buf, "%s%s %.1f%%", lineBreak, profileStages[stage], profile.stage[stage] * 100 / profile.total);
+		other -= profile.stage[stage];
+	}
+	buf += sprintf(buf, "%sOther %.1f%%", lineBreak, std::max(other, 0.0) * 100 / profile.total);
+	buf += sprintf(buf, "%sConversion path %s", lineBreak, convertPath());
+	buf += sprintf(buf, "%sWorst block %.2f ms for %.2f ms of audio", lineBreak, profile.worst * 1000, profile.worstaudio * 1000);
+	buf += sprintf(buf, "%sDeadline used p50 %.1f%%, p99 %.1f%%, max %.1f%%", lineBreak,
+		latencyPercentile(profile, 0.5) * 100, latencyPercentile(profile, 0.99) * 100, profile.worstratio * 100);
+	buf += sprintf(buf, "%sDeadline missed %lld of %lld blocks", lineBreak, profile.misses, profile.blocks);
+	return (int)(buf - start);
+}
+// one line per song in sidevo-profile.txt next to the plugin
+static void saveProfile() {
+	if (!sidSetting.c_profile || !sidEngine.p_profile.blocks) {
+		return;
+	}
+	if (FILE* file = fopen(pluginFile("sidevo-profile.txt").c_str(), "a")) {
+		char profileText[1024];
+		formatProfile(profileText, ", ");
+		fprintf(file, "%s #%d, %s %s, %d Hz %d ch: %s\n", sidEngine.p_songinfo->infoString(0), sidEngine.p_subsong, sidEngine.p_sidmodel, sidEngine.p_clockspeed,
+			sidEngine.m_config.frequency, sidEngine.m_config.playback, profileText);
+		fclose(file);
+	}
+}
+
 static void WINAPI SIDevo_GetGeneralInfo(char* buf)
 {
+	SIDtracescope traceScope("GetGeneralInfo", "xmpin");
 	static char temp[32]; // buffer for simpleLength
 
 	buf += sprintf(buf, "%s\t%s\r", "Format", sidEngine.p_songinfo->formatString());
@@ -742,6 +1419,25 @@ static void WINAPI SIDevo_GetGeneralInfo(char* buf)
 
 	buf += sprintf(buf, "%s\t%s\r", "Length", simpleLength(sidEngine.p_songlength, temp));
 	buf += sprintf(buf, "%s\t%s\r", "Library", "libsidplayfp-2.15.0");
+	buf += sprintf(buf, "%s\t%s\r", "Emulation", sidEngine.m_builder->name());
+	if (sidSetting.c_governor) {
+		static const char* tierNames[] = { "Full", "Normal sampling", "Normal sampling, filter off" };
+		buf += sprintf(buf, "%s\t%s%s, %d switches\r", "Quality", tierNames[sidEngine.g_tier],
+			governedSampling() != sidEngine.m_config.samplingMethod || governedFilter() != sidEngine.g_filter ? " (from next song)" : "", sidEngine.g_switches);
+	}
+
+	// where playback time goes, while profiling is on
+	if (sidSetting.c_profile) {
+		buf += sprintf(buf, "%s\t", "Profile");
+		buf += formatProfile(buf, "\r\t");
+		buf += sprintf(buf, "\r");
+	}
+
+	// queued database errors
+	std::lock_guard<std::mutex> statusLock(sidEngine.d_statuslock);
+	for (const std::string& statusLine : sidEngine.d_status) {
+		buf += sprintf(buf, "%s\t%s\r", "Status", statusLine.c_str());
+	}
 }
 static inline unsigned char petscii2ascii(unsigned char ch)
 {
@@ -763,7 +1459,7 @@ static void fetchWDS(char** buf) {
 		wdsName = wdsName.substr(0, wdsName.find_last_of('.')) + wdsExt;
 
 		// fetch wds file
-		std::ifstream fin(wdsName, std::ios::binary || std::ios::in);
+		std::ifstream fin(wdsName, std::ios::binary | std::ios::in);
 		if (fin) {
 			std::vector<char> petscii, ascii;
 			char c;
@@ -803,6 +1499,7 @@ static void fetchWDS(char** buf) {
 }
 static void WINAPI SIDevo_GetMessage(char* buf)
 {
+	SIDtracescope traceScope("GetMessage", "xmpin");
 	// add basic song information and any comments/info
 	static const char* tagname[3] = { "title", "artist", "date" };
 	for (int a = 0; a < 3; a++) {
@@ -818,7 +1515,7 @@ static void WINAPI SIDevo_GetMessage(char* buf)
 		buf += sprintf(buf, "MUS Comments\t-=-\r");
 		for (int b = 0; b < sidEngine.p_songinfo->numberOfCommentStrings(); b++) {
 			char* commentval = xmpftext->Utf8(sidEngine.p_songinfo->commentString(b), -1);
-			if (commentval != '\0') {
+			if (commentval != NULL) {
 				buf += sprintf(buf, "%s\r", commentval);
 			}
 			xmpfmisc->Free(commentval);
@@ -832,8 +1529,9 @@ static void WINAPI SIDevo_GetMessage(char* buf)
 	fetchWDS(&buf);
 
 	// load STIL database
-	loadSTILbase();
-	if (sidEngine.d_loadedstil && strlen(sidEngine.o_filename) > 4) {
+	requestDatabases();
+	std::shared_ptr<SIDstilbase> stilGen = std::atomic_load(&sidEngine.d_stilbase);
+	if (stilGen && strlen(sidEngine.o_filename) > 4) {
 		const char* stilGlobal = NULL;
 		const char* stilComment = NULL;
 		const char* stilEntry = NULL;
@@ -843,41 +1541,260 @@ static void WINAPI SIDevo_GetMessage(char* buf)
 			stilSubsong = sidEngine.p_subsong;
 		}
 
-		// txt stil lookup
-		if (sidEngine.d_loadedstil) {
-			stilGlobal = sidEngine.d_stilbase.getAbsGlobalComment(sidEngine.o_filename);
-			if (stilGlobal != NULL) {
-				buf += sprintf(buf, "STIL Global Comment\t-=-\r");
-				formatSTILbase(stilGlobal, &buf);
+		// txt stil lookup, entries point into the generation so hold it for the whole block
+		std::lock_guard<std::mutex> stilLock(stilGen->lock);
+		stilGlobal = stilGen->base.getAbsGlobalComment(sidEngine.o_filename);
+		if (stilGlobal != NULL) {
+			buf += sprintf(buf, "STIL Global Comment\t-=-\r");
+			formatSTILbase(stilGlobal, &buf);
+			buf += sprintf(buf, "\r");
+		}
+		if (sidSetting.c_subsongstil) {
+			stilComment = stilGen->base.getAbsEntry(sidEngine.o_filename, 0, STIL::comment);
+			if (stilComment != NULL) {
+				buf += sprintf(buf, "STIL SID Comment\t-=-\r");
+				formatSTILbase(stilComment, &buf);
 				buf += sprintf(buf, "\r");
 			}
-			if (sidSetting.c_subsongstil) {
-				stilComment = sidEngine.d_stilbase.getAbsEntry(sidEngine.o_filename, 0, STIL::comment);
-				if (stilComment != NULL) {
-					buf += sprintf(buf, "STIL SID Comment\t-=-\r");
-					formatSTILbase(stilComment, &buf);
-					buf += sprintf(buf, "\r");
-				}
+		}
+		stilEntry = stilGen->base.getAbsEntry(sidEngine.o_filename, stilSubsong, STIL::all);
+		if (stilEntry != NULL) {
+			buf += sprintf(buf, "STIL Tune Entry\t-=-\r");
+			formatSTILbase(stilEntry, &buf);
+			buf += sprintf(buf, "\r");
+		}
+		stilBug = stilGen->base.getAbsBug(sidEngine.o_filename, sidEngine.p_subsong);
+		if (stilBug != NULL) {
+			buf += sprintf(buf, "STIL Tune Bug\t-=-\r");
+			formatSTILbase(stilBug, &buf);
+			buf += sprintf(buf, "\r");
+		}
+	}
+}
+
+// fetch the sub-song lengths from the current database generation
+static void fetchSonglengths() {
+	sidEngine.p_songgen = std::atomic_load(&sidEngine.d_songdbase);
+	sidEngine.p_detectgen = sidEngine.d_detectgen;
+	sidEngine.p_songlength = 0;
+	for (int si = 1; si <= sidEngine.p_songcount; si++) {
+		int defaultduration = fetchSonglength(sidEngine.p_song, si);
+		sidEngine.p_subsonglength[si] = defaultduration;
+		sidEngine.p_songlength += defaultduration;
+	}
+}
+static void applyPlaybacklength() {
+	sidEngine.p_playbacklength = sidEngine.p_subsonglength[sidEngine.p_subsong];
+	// add fade out if set
+	if (sidEngine.p_playbacklength != 0 && sidSetting.c_fadeout && sidSetting.c_addfadeout) {
+		sidEngine.p_playbacklength += (sidSetting.c_fadeoutms / 1000);
+	}
+	// the silence gate ended the song early
+	if (sidEngine.p_trimend > 0 && (sidEngine.p_playbacklength == 0 || sidEngine.p_trimend < sidEngine.p_playbacklength)) {
+		sidEngine.p_playbacklength = sidEngine.p_trimend;
+	}
+	// pass duration to xmplay, less any leading silence that was skipped
+	float playbacklength = 0;
+	if (sidEngine.p_playbacklength != 0) {
+		playbacklength = std::max<float>(sidEngine.p_playbacklength - sidEngine.p_leadtrim / 1000.f, 0.001f);
+	}
+	if (sidEngine.p_playbacklength == 0 || sidSetting.c_disableseek) {
+		xmpfin->SetLength(playbacklength, FALSE);
+	} else {
+		xmpfin->SetLength(playbacklength, TRUE);
+	}
+}
+// time played so far, the loop cache keeps counting after the emulator has stopped
+static unsigned int playbackTime() {
+	return sidEngine.m_engine->time() + (unsigned int)(sidEngine.p_loopreplayed / (sidEngine.m_config.frequency * sidEngine.m_config.playback));
+}
+// silence gate, samples at or below this level count as silent (about -60dB)
+#define SILENCE_LEVEL 32
+#define SILENCE_LEADMAX 60
+#define SILENCE_LEADSTEP 2
+static void resetSilencegate() {
+	sidEngine.trimlead = sidSetting.c_trimsilence;
+	sidEngine.trimheard = FALSE;
+	sidEngine.trimsilent = 0;
+	sidEngine.p_leadtrim = 0;
+	sidEngine.p_trimend = 0;
+}
+// fast-forward until the first audible sample, nothing before it is passed to xmplay; a call skips a few seconds at
+// most so a long silent intro doesn't stall one Process call, a single silent frame is handed back until it's over
+static int trimLeadingsilence(short* sidbuffer, int sidDone, int count) {
+	int leadmax = SILENCE_LEADMAX;
+	if (sidEngine.p_playbacklength != 0 && sidEngine.p_playbacklength < leadmax) {
+		leadmax = sidEngine.p_playbacklength;
+	}
+	const unsigned int stepEnd = sidEngine.m_engine->timeMs() + SILENCE_LEADSTEP * 1000;
+	int audible;
+	for (;;) {
+		audible = 0;
+		while (audible < sidDone && abs(sidbuffer[audible]) <= SILENCE_LEVEL) {
+			audible++;
+		}
+		if (audible < sidDone || sidDone < count || (int)sidEngine.m_engine->time() >= leadmax) {
+			break;
+		}
+		if (sidEngine.m_engine->timeMs() >= stepEnd) {
+			std::fill(sidbuffer, sidbuffer + sidEngine.m_config.playback, 0);
+			return sidEngine.m_config.playback;
+		}
+		sidDone = sidEngine.m_engine->play(sidbuffer, count);
+	}
+	sidEngine.trimlead = FALSE;
+
+	// start the block on the audible frame and top it back up
+	if (audible < sidDone) {
+		audible -= audible % sidEngine.m_config.playback;
+		memmove(sidbuffer, sidbuffer + audible, (sidDone - audible) * sizeof(short));
+		sidDone -= audible;
+		sidDone += sidEngine.m_engine->play(sidbuffer + sidDone, audible);
+	}
+	int blockMs = (int)((long long)sidDone * 1000 / (sidEngine.m_config.frequency * sidEngine.m_config.playback));
+	sidEngine.p_leadtrim = std::max<int>(sidEngine.m_engine->timeMs() - blockMs, 0);
+	if (sidEngine.p_leadtrim > 0) {
+		applyPlaybacklength();
+	}
+	return sidDone;
+}
+// end the song once the output has stayed silent long enough
+static void trimTrailingsilence(const short* sidbuffer, int sidDone) {
+	for (int i = 0; i < sidDone; i++) {
+		if (abs(sidbuffer[i]) > SILENCE_LEVEL) {
+			sidEngine.trimheard = TRUE;
+			sidEngine.trimsilent = 0;
+		} else if (sidEngine.trimheard) {
+			sidEngine.trimsilent++;
+		}
+	}
+	if (sidEngine.trimheard && sidEngine.trimsilent >= sidSetting.c_silencesec * (int)sidEngine.m_config.frequency * sidEngine.m_config.playback) {
+		sidEngine.p_trimend = std::max<int>(playbackTime(), 1);
+		sidEngine.trimheard = FALSE;
+		applyPlaybacklength();
+	}
+}
+// loop cache, a song the detector saw return to the same RAM and SID register state has one pass recorded and then
+// replayed from memory; the chips' own oscillators, envelopes and filters aren't part of that state and a pass is
+// rounded to whole samples, so the pass is joined onto its own end with a short crossfade rather than bit-exact, and
+// very short loops (held notes, drones) are left alone
+#define LOOP_OFF 0
+#define LOOP_WAIT 1
+#define LOOP_CAPTURE 2
+#define LOOP_SEAM 3
+#define LOOP_REPLAY 4
+#define LOOP_MINSEC 1
+#define LOOP_MAXSEC 180
+#define LOOP_SEAMMS 10
+static void resetLoopcache() {
+	sidEngine.p_loopstate = LOOP_OFF;
+	sidEngine.p_loopbuf = std::vector<short>();
+	sidEngine.p_looppos = 0;
+	sidEngine.p_loopreplayed = 0;
+	if (!sidSetting.c_loopcache) {
+		return;
+	}
+
+	char md5[SidTune::MD5_LENGTH + 1];
+	sidEngine.p_song->createMD5New(md5);
+	std::lock_guard<std::mutex> detectLock(sidEngine.d_detectlock);
+	std::map<std::string, std::vector<SIDloop>>::iterator loopEntry = sidEngine.d_loopcache.find(md5);
+	if (loopEntry != sidEngine.d_loopcache.end() && sidEngine.p_subsong <= (int)loopEntry->second.size()) {
+		sidEngine.p_loop = loopEntry->second[sidEngine.p_subsong - 1];
+		if (sidEngine.p_loop.period >= LOOP_MINSEC && sidEngine.p_loop.period <= LOOP_MAXSEC) {
+			sidEngine.p_loopstate = LOOP_WAIT;
+		}
+	}
+}
+// record one pass of the loop, then fade what the emulator plays after it into the recorded start of the pass, which
+// is the same crossfade every later pass starts with; the block is rewritten in place from the switch on
+static void captureLoopcache(short* sidbuffer, int sidDone) {
+	if (sidEngine.p_loopstate == LOOP_WAIT) {
+		// start a second into the repeating part so a different power-on delay doesn't matter
+		if (sidEngine.m_engine->timeMs() < (sidEngine.p_loop.start + 1) * 1000) {
+			return;
+		}
+		// not worth it when the song ends before the loop could be replayed
+		if (sidEngine.p_playbacklength != 0 && playbackTime() + 3 * sidEngine.p_loop.period > sidEngine.p_playbacklength) {
+			sidEngine.p_loopstate = LOOP_OFF;
+			return;
+		}
+		sidEngine.p_loopbuf.resize((size_t)std::llround(sidEngine.p_loop.period * sidEngine.m_config.frequency) * sidEngine.m_config.playback);
+		sidEngine.p_loopseam = (size_t)(sidEngine.m_config.frequency * LOOP_SEAMMS / 1000) * sidEngine.m_config.playback;
+		sidEngine.p_looppos = 0;
+		sidEngine.p_loopstate = LOOP_CAPTURE;
+	}
+
+	const size_t seamFrames = sidEngine.p_loopseam / sidEngine.m_config.playback;
+	for (int i = 0; i < sidDone; i++) {
+		short& loopSample = sidEngine.p_loopbuf[sidEngine.p_looppos];
+		if (sidEngine.p_loopstate == LOOP_CAPTURE) {
+			loopSample = sidbuffer[i];
+			if (++sidEngine.p_looppos == sidEngine.p_loopbuf.size()) {
+				sidEngine.p_looppos = 0;
+				sidEngine.p_loopstate = LOOP_SEAM;
 			}
-			stilEntry = sidEngine.d_stilbase.getAbsEntry(sidEngine.o_filename, stilSubsong, STIL::all);
-			if (stilEntry != NULL) {
-				buf += sprintf(buf, "STIL Tune Entry\t-=-\r");
-				formatSTILbase(stilEntry, &buf);
-				buf += sprintf(buf, "\r");
+		} else if (sidEngine.p_loopstate == LOOP_SEAM) {
+			const float seamWeight = (float)(sidEngine.p_looppos / sidEngine.m_config.playback + 1) / seamFrames;
+			loopSample = (short)std::lrint(sidbuffer[i] + (loopSample - sidbuffer[i]) * seamWeight);
+			sidbuffer[i] = loopSample;
+			if (++sidEngine.p_looppos == sidEngine.p_loopseam) {
+				sidEngine.p_loopstate = LOOP_REPLAY;
 			}
-			stilBug = sidEngine.d_stilbase.getAbsBug(sidEngine.o_filename, sidEngine.p_subsong);
-			if (stilBug != NULL) {
-				buf += sprintf(buf, "STIL Tune Bug\t-=-\r");
-				formatSTILbase(stilBug, &buf);
-				buf += sprintf(buf, "\r");
+		} else {
+			// the rest of the block already comes from the pass, the emulator did play it so it isn't counted as replayed
+			sidbuffer[i] = loopSample;
+			if (++sidEngine.p_looppos == sidEngine.p_loopbuf.size()) {
+				sidEngine.p_looppos = 0;
 			}
 		}
 	}
 }
+static int replayLoopcache(short* sidbuffer, int count) {
+	for (int i = 0; i < count; i++) {
+		sidbuffer[i] = sidEngine.p_loopbuf[sidEngine.p_looppos];
+		if (++sidEngine.p_looppos == sidEngine.p_loopbuf.size()) {
+			sidEngine.p_looppos = 0;
+		}
+	}
+	sidEngine.p_loopreplayed += count;
+	return count;
+}
+// pick up databases that finished loading (or were swapped) after the song was opened
+static void refreshSonginfo() {
+	bool songChanged = false;
+	if (sidEngine.p_songgen != std::atomic_load(&sidEngine.d_songdbase)) {
+		fetchSonglengths();
+		applyPlaybacklength();
+		if (sidEngine.p_loopstate == LOOP_OFF) {
+			resetLoopcache();
+		}
+		songChanged = true;
+	} else if (sidEngine.p_detectgen != sidEngine.d_detectgen) {
+		// the detector finished some tune, only this one's own lengths change what XMPlay is told
+		const std::vector<int> playedLengths(sidEngine.p_subsonglength + 1, sidEngine.p_subsonglength + sidEngine.p_songcount + 1);
+		fetchSonglengths();
+		if (sidEngine.p_loopstate == LOOP_OFF) {
+			resetLoopcache();
+		}
+		if (!std::equal(playedLengths.begin(), playedLengths.end(), sidEngine.p_subsonglength + 1)) {
+			applyPlaybacklength();
+			songChanged = true;
+		}
+	}
+	if (sidEngine.p_sididgen != std::atomic_load(&sidEngine.d_sididbase)) {
+		fetchSIDId(sidEngine.p_songbuf);
+		songChanged = true;
+	}
+	if (songChanged) {
+		xmpfin->UpdateTitle(NULL);
+	}
+}
 
 // handle playback
 static DWORD WINAPI SIDevo_Open(const char* filename, XMPFILE file)
 {
+	SIDtracescope traceScope("Open", "xmpin");
 	SIDevo_Init();
 	if (sidEngine.b_loaded) {
 		// load sid file information into struct for reference
@@ -943,34 +1860,24 @@ static DWORD WINAPI SIDevo_Open(const char* filename, XMPFILE file)
 				sidEngine.skiptrigger = FALSE;
 			}
 
-			// detect player
-			loadSIDId();
+			// detect player, if the databases are still loading the default length is used until they arrive
+			requestDatabases();
+			sidEngine.p_songbuf = c64buf;
 			fetchSIDId(c64buf);
 
 			// load lengths
-			loadSonglength();
 			sidEngine.p_subsonglength = new int[sidEngine.p_songcount + 1];
-			sidEngine.p_songlength = 0;
-			for (int si = 1; si <= sidEngine.p_songcount; si++) {
-				int defaultduration = fetchSonglength(sidEngine.p_song, si);
-				sidEngine.p_subsonglength[si] = defaultduration;
-				sidEngine.p_songlength += defaultduration;
-			}
+			fetchSonglengths();
+			requestDetection(sidEngine.p_song, c64buf, sidSetting.c_loopcache);
 
 			if (sidEngine.m_engine->load(sidEngine.p_song)) {
-				sidEngine.p_playbacklength = sidEngine.p_subsonglength[sidEngine.p_subsong];
-				// add fade out if set
-				if (sidEngine.p_playbacklength != 0 && sidSetting.c_fadeout && sidSetting.c_addfadeout) {
-					sidEngine.p_playbacklength += (sidSetting.c_fadeoutms / 1000);
-				}
-				// pass duration to xmplay
-				if (sidEngine.p_playbacklength == 0 || sidSetting.c_disableseek) {
-					xmpfin->SetLength(sidEngine.p_playbacklength, FALSE);
-				} else {
-					xmpfin->SetLength(sidEngine.p_playbacklength, TRUE);
-				}
+				resetSilencegate();
+				applyPlaybacklength();
+				resetLoopcache();
+				resetProfile();
 				sidEngine.fadein = 0; // trigger fade-in
 				sidEngine.fadeout = 1; // trigger fade-out
+				sidEngine.fadedout = false;
 				return 2;
 			} else {
 				return 0;
@@ -982,17 +1889,25 @@ static DWORD WINAPI SIDevo_Open(const char* filename, XMPFILE file)
 }
 static void WINAPI SIDevo_Close()
 {
+	SIDtracescope traceScope("Close", "xmpin");
 	if (sidEngine.p_song) {
+		saveProfile();
+		if (sidSetting.c_trace) {
+			traceWrite(pluginFile("sidevo-trace.json"));
+		}
 		if (sidEngine.m_engine->isPlaying()) {
 			sidEngine.m_engine->stop();
 		}
+		// the engine outlives the song now, it mustn't keep pointing at it
+		sidEngine.m_engine->load(0);
 		delete sidEngine.p_subsonglength;
 		delete sidEngine.p_sididplayer;
 		delete sidEngine.p_sididplayers;
 		delete sidEngine.p_song;
+		sidEngine.p_loopbuf = std::vector<short>();
 	}
 }
-static DWORD WINAPI SIDevo_Process(float* buffer, DWORD count)
+static DWORD processBlock(float* buffer, DWORD count)
 {
 	// enforce default options
 	if (sidSetting.c_defaultskip && sidSetting.c_defaultonly && sidEngine.p_subsong != sidEngine.p_defsubsong) {
@@ -1003,28 +1918,33 @@ static DWORD WINAPI SIDevo_Process(float* buffer, DWORD count)
 		sidEngine.skiptrigger = FALSE;
 	}
 
+	// late database arrivals
+	refreshSonginfo();
+
 	// skip short song
 	if (sidSetting.c_skipshort && sidSetting.c_minlength >= sidEngine.p_subsonglength[sidEngine.p_subsong]) {
 		return 0;
 	}
 
 	// process
-	if (sidEngine.m_engine->time() < sidEngine.p_playbacklength || sidEngine.p_playbacklength == 0) {
-		// set-up fade-in & fade-out
-		float fadestep;
+	if (playbackTime() < sidEngine.p_playbacklength || sidEngine.p_playbacklength == 0) {
+		// set-up fade-in & fade-out, each with its own step as a fade-in can hand over to the fade-out inside a block
+		float fadeinstep = 1;
+		float fadeoutstep = 0;
 		if (sidEngine.fadein < 1) {
 			if (sidSetting.c_fadein && sidSetting.c_fadeinms > 0) {
 				if (!sidEngine.fadein) sidEngine.fadein = 0.001;
-				fadestep = pow(10, 3000.0 / sidSetting.c_fadeinms / (sidEngine.m_config.frequency * sidEngine.m_config.playback));
+				fadeinstep = pow(10, 3000.0 / sidSetting.c_fadeinms / (sidEngine.m_config.frequency * sidEngine.m_config.playback));
 			} else
 				sidEngine.fadein = 1;
-		} else if (sidEngine.fadeout > 0) {
+		}
+		if (sidEngine.fadeout > 0) {
 			if (sidSetting.c_fadeout && sidSetting.c_fadeoutms > 0) {
 				sidEngine.fadeouttrigger = sidEngine.p_playbacklength - sidSetting.c_fadeoutms / 1000; // calc trigger fade-out
 				if (sidEngine.fadeouttrigger + 1 > 0) {
 					if (sidEngine.fadeout == 1) sidEngine.fadeout = 0.999;
-					//fadestep = 1.0 / (float)((sidSetting.c_fadeoutms / static_cast<float>(1000)) * sidEngine.m_config.frequency * sidEngine.m_config.playback);                    
-					fadestep = 1.0 / (float)((sidSetting.c_fadeoutms / 1000) * sidEngine.m_config.frequency * sidEngine.m_config.playback);
+					//fadeoutstep = 1.0 / (float)((sidSetting.c_fadeoutms / static_cast<float>(1000)) * sidEngine.m_config.frequency * sidEngine.m_config.playback);                    
+					fadeoutstep = 1.0 / (float)((sidSetting.c_fadeoutms / 1000) * sidEngine.m_config.frequency * sidEngine.m_config.playback);
 				} else
 					sidEngine.fadeout = 0;
 			} else
@@ -1033,21 +1953,50 @@ static DWORD WINAPI SIDevo_Process(float* buffer, DWORD count)
 
 		int sidDone, i;
 		short* sidbuffer = new short[count];
-		sidDone = sidEngine.m_engine->play(sidbuffer, count);
-		for (i = 0; i < sidDone; i++) {
-			float scale = 1 / 32768.f;
-			// perform fade-in & fade-out
-			if (sidEngine.fadein < 1) {
-				sidEngine.fadein *= fadestep;
-				if (sidEngine.fadein > 1) sidEngine.fadein = 1;
-				scale *= sidEngine.fadein;
-			} else if (sidEngine.fadeout > 0 && sidEngine.m_engine->time() > sidEngine.fadeouttrigger) {
-				//sidEngine.fadeout /= sidEngine.fadeoutstep;
-				sidEngine.fadeout -= fadestep;
-				if (sidEngine.fadeout < 0) sidEngine.fadeout = 0;
-				scale *= sidEngine.fadeout;
+		if (sidEngine.p_loopstate == LOOP_REPLAY) {
+			SIDstagetimer stageTimer(PROFILE_LOOPCACHE);
+			sidDone = replayLoopcache(sidbuffer, count);
+		} else {
+			{
+				SIDstagetimer stageTimer(PROFILE_EMULATION);
+				sidDone = sidEngine.m_engine->play(sidbuffer, count);
+			}
+			if (sidEngine.trimlead) {
+				SIDstagetimer stageTimer(PROFILE_SILENCE);
+				sidDone = trimLeadingsilence(sidbuffer, sidDone, count);
+			}
+			// the loop is only recorded once the leading silence is behind it
+			if (sidEngine.p_loopstate != LOOP_OFF && !sidEngine.trimlead) {
+				SIDstagetimer stageTimer(PROFILE_LOOPCACHE);
+				captureLoopcache(sidbuffer, sidDone);
 			}
-			buffer[i] = (float)(sidbuffer[i]) * scale;
+		}
+		{
+			SIDstagetimer stageTimer(PROFILE_CONVERSION);
+			// no fade anywhere in this block, convert it in one go with the vector path
+			bool plainBlock = sidEngine.fadein >= 1 && !(sidEngine.fadeout > 0 && playbackTime() > sidEngine.fadeouttrigger);
+			if (sidEngine.fadedout) {
+				// the fade-out has finished, hold the silence until the song ends
+				std::fill(buffer, buffer + sidDone, 0.f);
+			} else if (plainBlock) {
+				convertSamples(sidbuffer, buffer, sidDone, 1 / 32768.f);
+			} else {
+				// perform fade-in & fade-out, a fade-in that ends inside the block hands the rest to the fade-out or the plain path
+				i = 0;
+				if (sidEngine.fadein < 1) {
+					i = convertFadein(sidbuffer, buffer, sidDone, 1 / 32768.f, fadeinstep, &sidEngine.fadein);
+				}
+				if (sidEngine.fadeout > 0 && playbackTime() > sidEngine.fadeouttrigger) {
+					convertFadeout(sidbuffer + i, buffer + i, sidDone - i, 1 / 32768.f, fadeoutstep, &sidEngine.fadeout);
+					sidEngine.fadedout = sidEngine.fadeout <= 0;
+				} else {
+					convertSamples(sidbuffer + i, buffer + i, sidDone - i, 1 / 32768.f);
+				}
+			}
+		}
+		if (sidSetting.c_trimsilence) {
+			SIDstagetimer stageTimer(PROFILE_SILENCE);
+			trimTrailingsilence(sidbuffer, sidDone);
 		}
 		delete sidbuffer;
 
@@ -1056,17 +2005,45 @@ static DWORD WINAPI SIDevo_Process(float* buffer, DWORD count)
 		return 0;
 	}
 }
+static DWORD WINAPI SIDevo_Process(float* buffer, DWORD count)
+{
+	SIDtracescope traceScope("Process", "xmpin");
+	// the toggle is only looked at here so a block is timed either whole or not at all
+	sidEngine.p_profiling = sidSetting.c_profile;
+	if (!sidEngine.p_profiling && !sidSetting.c_governor && sidEngine.g_tier == GOVERNOR_FULL) {
+		return processBlock(buffer, count);
+	}
+	std::chrono::steady_clock::time_point blockStart = std::chrono::steady_clock::now();
+	DWORD blockDone = processBlock(buffer, count);
+	double blockTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - blockStart).count();
+	if (sidEngine.p_profiling) {
+		profileBlock(blockTime, count, blockDone);
+	}
+	governBlock(blockTime, blockDone);
+	return blockDone;
+}
 static void WINAPI SIDevo_SetFormat(XMPFORMAT* form)
 {
+	SIDtracescope traceScope("SetFormat", "xmpin");
 	// changing format seems to rewind the SID decoder? so only do that at start
 	if (!sidEngine.m_engine->timeMs()) {
-		if (sidSetting.c_forcemono) {
-			sidEngine.m_config.playback = SidConfig::MONO;
-		} else {
-			sidEngine.m_config.frequency = std::max<DWORD>(form->rate, 8000);
-			sidEngine.m_config.playback = (SidConfig::playback_t)std::min<DWORD>(form->chan, 2);
+		DWORD frequency = sidEngine.m_config.frequency;
+		SidConfig::playback_t playback = SidConfig::MONO;
+		if (!sidSetting.c_forcemono) {
+			frequency = std::max<DWORD>(form->rate, 8000);
+			playback = (SidConfig::playback_t)std::min<DWORD>(form->chan, 2);
+		}
+		// loading the tune already built the SIDs and resamplers, only build them again when the format differs
+		SidConfig::sampling_method_t samplingMethod = governedSampling();
+		if (frequency != sidEngine.m_config.frequency || playback != sidEngine.m_config.playback || samplingMethod != sidEngine.m_config.samplingMethod) {
+			sidEngine.m_config.frequency = frequency;
+			sidEngine.m_config.playback = playback;
+			sidEngine.m_config.samplingMethod = samplingMethod;
+			applyConfig(FALSE);
+		} else if (governedFilter() != sidEngine.g_filter) {
+			sidEngine.g_filter = governedFilter();
+			sidEngine.m_builder->filter(sidEngine.g_filter);
 		}
-		applyConfig(FALSE);
 	}
 	form->rate = sidEngine.m_config.frequency;
 	form->chan = sidEngine.m_config.playback;
@@ -1074,11 +2051,14 @@ static void WINAPI SIDevo_SetFormat(XMPFORMAT* form)
 }
 static double WINAPI SIDevo_GetGranularity()
 {
+	SIDtracescope traceScope("GetGranularity", "xmpin");
 	return 0.001;
 }
 static double WINAPI SIDevo_SetPosition(DWORD pos)
 {
+	SIDtracescope traceScope("SetPosition", "xmpin");
 	if (pos & XMPIN_POS_SUBSONG1 || pos & XMPIN_POS_SUBSONG) {
+		saveProfile();
 		if (sidEngine.m_engine->isPlaying()) {
 			sidEngine.m_engine->stop();
 		}
@@ -1086,29 +2066,28 @@ static double WINAPI SIDevo_SetPosition(DWORD pos)
 		sidEngine.p_song->selectSong(sidEngine.p_subsong);
 		sidEngine.m_engine->load(sidEngine.p_song);
 		//
-		sidEngine.p_playbacklength = sidEngine.p_subsonglength[sidEngine.p_subsong];
-		// add fade out if set
-		if (sidEngine.p_playbacklength != 0 && sidSetting.c_fadeout && sidSetting.c_addfadeout) {
-			sidEngine.p_playbacklength += (sidSetting.c_fadeoutms / 1000);
-		}
-		// pass duration to xmplay
-		if (sidEngine.p_playbacklength == 0 || sidSetting.c_disableseek) {
-			xmpfin->SetLength(sidEngine.p_playbacklength, FALSE);
-		} else {
-			xmpfin->SetLength(sidEngine.p_playbacklength, TRUE);
-		}
+		resetSilencegate();
+		applyPlaybacklength();
+		resetLoopcache();
+		resetProfile();
 		sidEngine.fadein = 0; // trigger fade-in (needed?)
 		sidEngine.fadeout = 1; // trigger fade-out (needed?)
+		sidEngine.fadedout = false;
 		xmpfin->UpdateTitle(NULL);
 		//
 		return 0;
 	} else {
-		double seekTarget = pos * SIDevo_GetGranularity();
+		// positions exclude the leading silence that was skipped
+		double seekTarget = pos * SIDevo_GetGranularity() + sidEngine.p_leadtrim / 1000.0;
 		double seekState = sidEngine.m_engine->timeMs() / 1000.0;
+		sidEngine.trimsilent = 0;
+		if (sidEngine.p_loopstate != LOOP_OFF) {
+			resetLoopcache();
+		}
 		int seekResult;
 
 		if (seekTarget == seekState)
-			return seekTarget;
+			return seekTarget - sidEngine.p_leadtrim / 1000.0;
 
 		//oh dear we have to go back
 		if (seekTarget < seekState) {
@@ -1127,16 +2106,20 @@ static double WINAPI SIDevo_SetPosition(DWORD pos)
 		delete[] seekBuffer;
 		if (seekResult == seekCount) {
 			sidEngine.fadein = pos ? 1 : 0; // trigger fade-in if restarting
-			if (!pos || pos < sidEngine.fadeouttrigger)
+			// the fade-out starts once the whole seconds played pass the trigger, a seek that lands before that undoes it
+			if (!pos || seekTarget < sidEngine.fadeouttrigger + 1) {
 				sidEngine.fadeout = 1; // trigger fade-out if restarting
+				sidEngine.fadedout = false;
+			}
 
-			return seekTarget;
+			return seekTarget - sidEngine.p_leadtrim / 1000.0;
 		} else {
 			return -1;
 		}
 	}
 }
 
+#ifndef SIDEVO_HEADLESS
 // handle configuration
 #define MESS(id,m,w,l) SendDlgItemMessage(hWnd,id,m,(WPARAM)(w),(LPARAM)(l))
 static BOOL CALLBACK CFGDialogProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
@@ -1184,6 +2167,14 @@ static BOOL CALLBACK CFGDialogProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lP
 				EnableWindow(GetDlgItem(hWnd, IDC_EDIT_MINLENGTH), FALSE);
 				EnableWindow(GetDlgItem(hWnd, IDC_LABEL_MINLENGTH), FALSE);
 			}
+		case IDC_CHECK_TRIMSILENCE:
+			if (MESS(IDC_CHECK_TRIMSILENCE, BM_GETCHECK, 0, 0)) {
+				EnableWindow(GetDlgItem(hWnd, IDC_EDIT_SILENCE), TRUE);
+				EnableWindow(GetDlgItem(hWnd, IDC_LABEL_SILENCE), TRUE);
+			} else {
+				EnableWindow(GetDlgItem(hWnd, IDC_EDIT_SILENCE), FALSE);
+				EnableWindow(GetDlgItem(hWnd, IDC_LABEL_SILENCE), FALSE);
+			}
 		case IDC_CHECK_RANDOMDELAY:
 			if (MESS(IDC_CHECK_RANDOMDELAY, BM_GETCHECK, 0, 0)) {
 				EnableWindow(GetDlgItem(hWnd, IDC_EDIT_POWERDELAY), FALSE);
@@ -1229,12 +2220,20 @@ static BOOL CALLBACK CFGDialogProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lP
 			sidSetting.c_addfadeout = (BST_CHECKED == MESS(IDC_CHECK_ADDFADEOUT, BM_GETCHECK, 0, 0));
 			sidSetting.c_subsongstil = (BST_CHECKED == MESS(IDC_CHECK_FETCHSUBSTIL, BM_GETCHECK, 0, 0));
 			sidSetting.c_forcemono = (BST_CHECKED == MESS(IDC_CHECK_FORCEMONO, BM_GETCHECK, 0, 0));
+			sidSetting.c_detectlength = (BST_CHECKED == MESS(IDC_CHECK_DETECTLENGTH, BM_GETCHECK, 0, 0));
+			sidSetting.c_trimsilence = (BST_CHECKED == MESS(IDC_CHECK_TRIMSILENCE, BM_GETCHECK, 0, 0));
+			sidSetting.c_loopcache = (BST_CHECKED == MESS(IDC_CHECK_LOOPCACHE, BM_GETCHECK, 0, 0));
+			sidSetting.c_profile = (BST_CHECKED == MESS(IDC_CHECK_PROFILE, BM_GETCHECK, 0, 0));
+			sidSetting.c_governor = (BST_CHECKED == MESS(IDC_CHECK_GOVERNOR, BM_GETCHECK, 0, 0));
+			sidSetting.c_trace = (BST_CHECKED == MESS(IDC_CHECK_TRACE, BM_GETCHECK, 0, 0));
 			MESS(IDC_COMBO_SID, WM_GETTEXT, 10, sidSetting.c_sidmodel);
 			MESS(IDC_COMBO_CLOCK, WM_GETTEXT, 10, sidSetting.c_clockspeed);
 			MESS(IDC_COMBO_SAMPLEMETHOD, WM_GETTEXT, 10, sidSetting.c_samplemethod);
+			MESS(IDC_COMBO_SIDENGINE, WM_GETTEXT, 10, sidSetting.c_sidengine);
 			MESS(IDC_EDIT_DBPATH, WM_GETTEXT, 250, sidSetting.c_dbpath);
 			sidSetting.c_defaultlength = GetDlgItemInt(hWnd, IDC_EDIT_DEFAULTLENGTH, NULL, false);
 			sidSetting.c_minlength = GetDlgItemInt(hWnd, IDC_EDIT_MINLENGTH, NULL, false);
+			sidSetting.c_silencesec = std::max<int>(GetDlgItemInt(hWnd, IDC_EDIT_SILENCE, NULL, false), 1);
 			sidSetting.c_powerdelay = GetDlgItemInt(hWnd, IDC_EDIT_POWERDELAY, NULL, false);
 			sidSetting.c_6581filter = SendDlgItemMessage(hWnd, IDC_SLIDE_6581LEVEL, TBM_GETPOS, 0, 0);
 			sidSetting.c_8580filter = SendDlgItemMessage(hWnd, IDC_SLIDE_8580LEVEL, TBM_GETPOS, 0, 0);
@@ -1243,6 +2242,7 @@ static BOOL CALLBACK CFGDialogProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lP
 
 			// apply configuraton
 			saveConfig();
+			applyTrace();
 			EndDialog(hWnd, 0);
 			break;
 		case IDC_BUTTON_FOLDER:
@@ -1269,6 +2269,10 @@ static BOOL CALLBACK CFGDialogProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lP
 		SendMessage(GetDlgItem(hWnd, IDC_COMBO_SAMPLEMETHOD), (UINT)CB_ADDSTRING, (WPARAM)0, (LPARAM)TEXT("Normal"));
 		SendMessage(GetDlgItem(hWnd, IDC_COMBO_SAMPLEMETHOD), (UINT)CB_ADDSTRING, (WPARAM)0, (LPARAM)TEXT("Accurate"));
 		SendMessage(GetDlgItem(hWnd, IDC_COMBO_SAMPLEMETHOD), CB_SELECTSTRING, (WPARAM)-1, (LPARAM)sidSetting.c_samplemethod);
+		SendMessage(GetDlgItem(hWnd, IDC_COMBO_SIDENGINE), (UINT)CB_ADDSTRING, (WPARAM)0, (LPARAM)TEXT("ReSIDfp"));
+		SendMessage(GetDlgItem(hWnd, IDC_COMBO_SIDENGINE), (UINT)CB_ADDSTRING, (WPARAM)0, (LPARAM)TEXT("ReSID"));
+		// exact match, ReSID is a prefix of ReSIDfp
+		SendMessage(GetDlgItem(hWnd, IDC_COMBO_SIDENGINE), CB_SETCURSEL, SendMessage(GetDlgItem(hWnd, IDC_COMBO_SIDENGINE), CB_FINDSTRINGEXACT, (WPARAM)-1, (LPARAM)sidSetting.c_sidengine), 0);
 		//
 		MESS(IDC_SLIDE_6581LEVEL, TBM_SETRANGE, TRUE, MAKELONG(0, 100));
 		MESS(IDC_SLIDE_6581LEVEL, TBM_SETPOS, TRUE, sidSetting.c_6581filter);
@@ -1295,8 +2299,15 @@ static BOOL CALLBACK CFGDialogProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lP
 		MESS(IDC_CHECK_FADEIN, BM_SETCHECK, sidSetting.c_fadein ? BST_CHECKED : BST_UNCHECKED, 0);
 		MESS(IDC_CHECK_FADEOUT, BM_SETCHECK, sidSetting.c_fadeout ? BST_CHECKED : BST_UNCHECKED, 0);
 		MESS(IDC_CHECK_FORCEMONO, BM_SETCHECK, sidSetting.c_forcemono ? BST_CHECKED : BST_UNCHECKED, 0);
+		MESS(IDC_CHECK_DETECTLENGTH, BM_SETCHECK, sidSetting.c_detectlength ? BST_CHECKED : BST_UNCHECKED, 0);
+		MESS(IDC_CHECK_TRIMSILENCE, BM_SETCHECK, sidSetting.c_trimsilence ? BST_CHECKED : BST_UNCHECKED, 0);
+		MESS(IDC_CHECK_LOOPCACHE, BM_SETCHECK, sidSetting.c_loopcache ? BST_CHECKED : BST_UNCHECKED, 0);
+		MESS(IDC_CHECK_PROFILE, BM_SETCHECK, sidSetting.c_profile ? BST_CHECKED : BST_UNCHECKED, 0);
+		MESS(IDC_CHECK_GOVERNOR, BM_SETCHECK, sidSetting.c_governor ? BST_CHECKED : BST_UNCHECKED, 0);
+		MESS(IDC_CHECK_TRACE, BM_SETCHECK, sidSetting.c_trace ? BST_CHECKED : BST_UNCHECKED, 0);
 		SetDlgItemInt(hWnd, IDC_EDIT_DEFAULTLENGTH, sidSetting.c_defaultlength, false);
 		SetDlgItemInt(hWnd, IDC_EDIT_MINLENGTH, sidSetting.c_minlength, false);
+		SetDlgItemInt(hWnd, IDC_EDIT_SILENCE, sidSetting.c_silencesec, false);
 		SetDlgItemInt(hWnd, IDC_EDIT_POWERDELAY, sidSetting.c_powerdelay, false);
 		SetDlgItemTextA(hWnd, IDC_EDIT_DBPATH, sidSetting.c_dbpath);
 		MESS(IDC_LABEL_STATUS, WM_SETTEXT, 0, pathTest().c_str());
@@ -1337,11 +2348,16 @@ static void WINAPI SIDevo_About(HWND win)
 {
 	DialogBox(ghInstance, MAKEINTRESOURCE(IDD_DIALOG_ABOUT), win, &CFGAboutProc);
 }
+#else
+// no dialogs without XMPlay, the host sets the registry values instead
+static void WINAPI SIDevo_Config(HWND win) {}
+static void WINAPI SIDevo_About(HWND win) {}
+#endif
 
 // plugin interface
 static XMPIN xmpin = {
 	0,
-	"SIDevo (v4.9.1)",
+	"SIDevo (v5.0)",
 	"SIDevo\0sid/mus/str",
 	SIDevo_About,
 	SIDevo_Config,
@@ -1397,10 +2413,30 @@ XMPIN * WINAPI XMPIN_GetInterface(DWORD face, InterfaceProc faceproc)
 	xmpfreg = (XMPFUNC_REGISTRY*)faceproc(XMPFUNC_REGISTRY_FACE);
 
 	loadConfig();
+	applyTrace();
+	requestDatabases();
 
 	return &xmpin;
 }
 
+#ifdef SIDEVO_HEADLESS
+// re-read the registry settings, the engine is rebuilt with them when the next song is opened
+#ifdef __cplusplus
+extern "C"
+#endif
+void WINAPI XMPIN_Reconfigure()
+{
+	sidEngine.b_reloadcfg = true;
+}
+// the host is done with the plugin, stop the database and detection workers before anything is torn down
+#ifdef __cplusplus
+extern "C"
+#endif
+void WINAPI XMPIN_Shutdown()
+{
+	stopWorkers();
+}
+#else
 BOOL WINAPI DllMain(HINSTANCE hDLL, DWORD reason, LPVOID reserved)
 {
 	switch (reason) {
@@ -1410,4 +2446,5 @@ BOOL WINAPI DllMain(HINSTANCE hDLL, DWORD reason, LPVOID reserved)
 		break;
 	}
 	return TRUE;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -8,6 +8,7 @@
 #define IDC_COMBO_SID   1010
 #define IDC_COMBO_CLOCK   1011
 #define IDC_COMBO_SAMPLEMETHOD 1012
+#define IDC_COMBO_SIDENGINE 1013
 #define IDC_CHECK_LOCKSID    1020
 #define IDC_CHECK_LOCKCLOCK    1021
 #define IDC_CHECK_ENABLEFILTER    1022
@@ -24,10 +25,17 @@
 #define IDC_CHECK_ADDFADEOUT    1033
 #define IDC_CHECK_FETCHSUBSTIL    1034
 #define IDC_CHECK_FORCEMONO    1035
+#define IDC_CHECK_DETECTLENGTH    1036
+#define IDC_CHECK_TRIMSILENCE    1037
+#define IDC_CHECK_LOOPCACHE    1038
+#define IDC_CHECK_PROFILE    1039
+#define IDC_CHECK_TRACE    1045
+#define IDC_CHECK_GOVERNOR    1046
 #define IDC_EDIT_DEFAULTLENGTH     1040
 #define IDC_EDIT_DBPATH     1041
 #define IDC_EDIT_POWERDELAY   1042
 #define IDC_EDIT_MINLENGTH     1043
+#define IDC_EDIT_SILENCE     1044
 #define IDC_SLIDE_6581LEVEL   1060
 #define IDC_SLIDE_8580LEVEL   1061
 #define IDC_SLIDE_FADEINLEVEL   1062
@@ -38,6 +46,7 @@
 #define IDC_LABEL_MINLENGTH   1083
 #define IDC_LABEL_FADEOUTLEVEL   1084
 #define IDC_LABEL_STATUS   1085
+#define IDC_LABEL_SILENCE   1086
 #define IDC_TITLE_6581LEVEL   1100
 #define IDC_TITLE_8580LEVEL   1101
 #define IDC_STATIC           -1